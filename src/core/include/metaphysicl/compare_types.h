@@ -154,6 +154,13 @@ struct BuiltinTraits {
       static const bool value = false;
 };
 
+// Fixed size containers which store every entry explicitly, and so
+// can't represent all zeros any more cheaply than any other value
+template <typename T, typename Enable=void>
+struct DenseTraits {
+      static const bool value = false;
+};
+
 #define ScalarBuiltin_true(type) \
 template<> \
 struct ScalarTraits<type> { static const bool value = true; }; \
@@ -0,0 +1,150 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// MetaPhysicL - A metaprogramming library for physics calculations
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+//
+// $Id$
+//
+//--------------------------------------------------------------------------
+
+#ifndef METAPHYSICL_DUALDIRECTIONAL_H
+#define METAPHYSICL_DUALDIRECTIONAL_H
+
+
+#include "metaphysicl/numberarray.h"
+#include "metaphysicl/numbervector.h"
+#include "metaphysicl/taylornumber.h"
+
+
+namespace MetaPhysicL {
+
+// Higher order derivatives along a single direction v, i.e.
+// d^k/dt^k f(x + t v) at t = 0, from a Taylor series in t truncated
+// after its t^order term.  Fully nesting DualNumbers over n
+// independent variables stores (n+1)^order values, and nesting them
+// over the single variable t still stores 2^order; the series stores
+// order+1, and every lower order derivative comes out of the same
+// evaluation.
+
+template <typename T, unsigned int order>
+struct DirectionalDualNumber
+{
+  typedef TaylorNumber<T, order> type;
+
+  // Returns x + t v
+  static type seed(const T& x, const T& v) { return type(x, v); }
+
+  // Sets out[k] = d^k/dt^k f, for 0 <= k <= order
+  static void derivatives(const type& f, T* out) {
+    for (unsigned int k=0; k <= order; ++k)
+      out[k] = f.derivative(k);
+  }
+
+  // Returns d^order/dt^order f alone
+  static T top(const type& f) { return f.derivative(order); }
+};
+
+
+// Returns f and its first through order-th derivatives along v at x.
+// f is called with a NumberVector of DirectionalDualNumber<T,order>
+// values and should return one of those values.
+
+template <unsigned int order, std::size_t N, typename T, typename Function>
+inline
+NumberArray<order+1, T>
+directional_derivatives(const Function& f,
+                        const NumberVector<N, T>& x,
+                        const NumberVector<N, T>& v)
+{
+  typedef DirectionalDualNumber<T, order> DD;
+
+  NumberVector<N, typename DD::type> xt;
+  for (std::size_t i=0; i != N; ++i)
+    xt[i] = DD::seed(x[i], v[i]);
+
+  const typename DD::type ft = f(xt);
+
+  NumberArray<order+1, T> returnval;
+  DD::derivatives(ft, &returnval[0]);
+  return returnval;
+}
+
+
+// Evaluates directional_derivatives along each of n_directions
+// directions, writing the results for directions[d] to results[d].
+// Directions are independent, so when OpenMP is enabled they are
+// striped across threads, each of which only holds the Taylor
+// series for the direction it is working on; f must be safe to call
+// concurrently.
+
+template <unsigned int order, std::size_t N, typename T, typename Function>
+inline
+void
+directional_derivatives(const Function& f,
+                        const NumberVector<N, T>& x,
+                        const NumberVector<N, T>* directions,
+                        std::size_t n_directions,
+                        NumberArray<order+1, T>* results)
+{
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (std::size_t d=0; d < n_directions; ++d)
+    results[d] = directional_derivatives<order>(f, x, directions[d]);
+}
+
+
+// Fills seeds[index...N-1] with the compile-time unit vectors
+template <std::size_t N, typename T, std::size_t index=0>
+struct DirectionalUnitSeeds
+{
+  static void fill(NumberVector<N, T>* seeds) {
+    seeds[index] = NumberVectorUnitVector<N, index, T>::value();
+    DirectionalUnitSeeds<N, T, index+1>::fill(seeds);
+  }
+};
+
+template <std::size_t N, typename T>
+struct DirectionalUnitSeeds<N, T, N>
+{
+  static void fill(NumberVector<N, T>*) {}
+};
+
+
+// Returns the pure partial derivatives d^k f / dx_i^k, for
+// 0 <= k <= order, along each coordinate direction i
+template <unsigned int order, std::size_t N, typename T, typename Function>
+inline
+NumberVector<N, NumberArray<order+1, T> >
+coordinate_derivatives(const Function& f,
+                       const NumberVector<N, T>& x)
+{
+  NumberVector<N, T> seeds[N];
+  DirectionalUnitSeeds<N, T>::fill(seeds);
+
+  NumberVector<N, NumberArray<order+1, T> > returnval;
+  directional_derivatives<order>(f, x, seeds, N, &returnval[0]);
+  return returnval;
+}
+
+} // namespace MetaPhysicL
+
+#endif // METAPHYSICL_DUALDIRECTIONAL_H
@@ -0,0 +1,214 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// MetaPhysicL - A metaprogramming library for physics calculations
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+//
+// $Id$
+//
+//--------------------------------------------------------------------------
+
+#ifndef METAPHYSICL_DUALJACOBIAN_H
+#define METAPHYSICL_DUALJACOBIAN_H
+
+#include <vector>
+
+#include "metaphysicl/dualnumberarray.h"
+#include "metaphysicl/metaphysicl_asserts.h"
+
+
+namespace MetaPhysicL {
+
+// A Jacobian with a fixed CSR sparsity pattern, evaluated by seeding
+// DualNumber derivatives by column color rather than by column.
+// Columns which never share a row are structurally orthogonal, so
+// they can share one derivative slot: the derivative width drops
+// from the number of columns to the number of colors, which for a
+// banded pattern is the bandwidth.
+
+template <typename T>
+class ColoredJacobian
+{
+public:
+  // row_offsets has n_rows+1 entries; the columns of row i are
+  // columns[row_offsets[i]] through columns[row_offsets[i+1]-1]
+  ColoredJacobian(std::size_t n_rows,
+                  std::size_t n_cols,
+                  const std::vector<std::size_t>& row_offsets,
+                  const std::vector<std::size_t>& columns);
+
+  std::size_t n_rows() const { return _n_rows; }
+
+  std::size_t n_cols() const { return _n_cols; }
+
+  const std::vector<std::size_t>& row_offsets() const { return _row_offsets; }
+
+  const std::vector<std::size_t>& columns() const { return _columns; }
+
+  const std::vector<T>& values() const { return _values; }
+
+  unsigned int n_colors() const { return _n_colors; }
+
+  const std::vector<unsigned int>& colors() const { return _colors; }
+
+  // Evaluates the Jacobian of residual at x into values().  residual
+  // is called as residual(xd, rd), with xd a std::vector of
+  // DualNumber<T, NumberArray<width, T> > independent variables and
+  // rd a std::vector of n_rows of the same, to be filled in.
+  //
+  // Colors are handled width at a time; these batches are
+  // independent, so when OpenMP is enabled they are evaluated in
+  // parallel, and residual must be safe to call concurrently.
+  template <std::size_t width, typename Function>
+  void compute(const Function& residual, const std::vector<T>& x);
+
+private:
+  void color_columns();
+
+  std::size_t _n_rows, _n_cols;
+  std::vector<std::size_t> _row_offsets, _columns;
+  std::vector<T> _values;
+
+  unsigned int _n_colors;
+  std::vector<unsigned int> _colors;
+};
+
+
+template <typename T>
+inline
+ColoredJacobian<T>::ColoredJacobian(std::size_t n_rows,
+                                    std::size_t n_cols,
+                                    const std::vector<std::size_t>& row_offsets,
+                                    const std::vector<std::size_t>& columns) :
+  _n_rows(n_rows),
+  _n_cols(n_cols),
+  _row_offsets(row_offsets),
+  _columns(columns),
+  _values(columns.size(), 0),
+  _n_colors(0),
+  _colors(n_cols, 0)
+{
+  metaphysicl_assert_equal_to(_row_offsets.size(), n_rows+1);
+  metaphysicl_assert_equal_to(_row_offsets.back(), columns.size());
+
+  this->color_columns();
+}
+
+
+// Greedy distance-2 coloring: each column takes the smallest color
+// not already used by any column it shares a row with
+template <typename T>
+inline
+void
+ColoredJacobian<T>::color_columns()
+{
+  // Rows of each column, in CSC order
+  std::vector<std::size_t> col_offsets(_n_cols+1, 0), rows(_columns.size());
+  for (std::size_t k=0; k != _columns.size(); ++k)
+    {
+      metaphysicl_assert_less(_columns[k], _n_cols);
+      ++col_offsets[_columns[k]+1];
+    }
+  for (std::size_t j=0; j != _n_cols; ++j)
+    col_offsets[j+1] += col_offsets[j];
+
+  std::vector<std::size_t> next(col_offsets.begin(), col_offsets.end()-1);
+  for (std::size_t i=0; i != _n_rows; ++i)
+    for (std::size_t k=_row_offsets[i]; k != _row_offsets[i+1]; ++k)
+      rows[next[_columns[k]]++] = i;
+
+  // forbidden[c] == j+1 marks color c as taken by a neighbor of j
+  std::vector<std::size_t> forbidden;
+
+  _n_colors = 0;
+  for (std::size_t j=0; j != _n_cols; ++j)
+    {
+      for (std::size_t r=col_offsets[j]; r != col_offsets[j+1]; ++r)
+        {
+          const std::size_t i = rows[r];
+          for (std::size_t k=_row_offsets[i]; k != _row_offsets[i+1]; ++k)
+            {
+              const std::size_t j2 = _columns[k];
+              if (j2 < j)
+                forbidden[_colors[j2]] = j+1;
+            }
+        }
+
+      unsigned int c = 0;
+      while (c != _n_colors && forbidden[c] == j+1)
+        ++c;
+
+      if (c == _n_colors)
+        {
+          ++_n_colors;
+          forbidden.push_back(0);
+        }
+
+      _colors[j] = c;
+    }
+}
+
+
+template <typename T>
+template <std::size_t width, typename Function>
+inline
+void
+ColoredJacobian<T>::compute(const Function& residual,
+                            const std::vector<T>& x)
+{
+  typedef DualNumber<T, NumberArray<width, T> > DualScalar;
+
+  metaphysicl_assert_equal_to(x.size(), _n_cols);
+
+  // Every nonzero gets written by exactly the batch holding its
+  // column's color, so batches never touch the same entries
+  const long n_batches = (_n_colors + width - 1) / width;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (long b = 0; b < n_batches; ++b)
+    {
+      const unsigned int first_color = b * width;
+
+      std::vector<DualScalar> xd(_n_cols), rd(_n_rows);
+      for (std::size_t j=0; j != _n_cols; ++j)
+        {
+          xd[j] = DualScalar(x[j]);
+          const unsigned int c = _colors[j];
+          if (c >= first_color && c < first_color + width)
+            xd[j].derivatives()[c - first_color] = 1;
+        }
+
+      residual(xd, rd);
+
+      for (std::size_t i=0; i != _n_rows; ++i)
+        for (std::size_t k=_row_offsets[i]; k != _row_offsets[i+1]; ++k)
+          {
+            const unsigned int c = _colors[_columns[k]];
+            if (c >= first_color && c < first_color + width)
+              _values[k] = rd[i].derivatives()[c - first_color];
+          }
+    }
+}
+
+} // namespace MetaPhysicL
+
+#endif // METAPHYSICL_DUALJACOBIAN_H
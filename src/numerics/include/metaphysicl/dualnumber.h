@@ -31,6 +31,7 @@
 
 #include "metaphysicl/dualnumber_decl.h"
 #include "metaphysicl/dualnumber_surrogate.h"
+#include "metaphysicl/integerpow.h"
 
 namespace MetaPhysicL {
 
@@ -50,7 +51,11 @@ DualNumber<T,D>::value() const { return _val; }
 template <typename T, typename D>
 inline
 D&
-DualNumber<T,D>::derivatives() { return _deriv; }
+DualNumber<T,D>::derivatives()
+{
+  this->set_derivatives_known_zero(false);
+  return _deriv;
+}
 
 template <typename T, typename D>
 inline
@@ -65,7 +70,12 @@ DualNumber<T,D>::boolean_test() const { return _val; }
 template <typename T, typename D>
 inline
 DualNumber<T,D>
-DualNumber<T,D>::operator- () const { return DualNumber<T,D>(-_val, -_deriv); }
+DualNumber<T,D>::operator- () const
+{
+  if (!dual_derivatives_enabled())
+    return DualNumber<T,D>(-_val);
+  return DualNumber<T,D>(-_val, -_deriv);
+}
 
 template <typename T, typename D>
 inline
@@ -80,6 +90,7 @@ DualNumber<T,D>::operator=(const DualNumber<T2,D2> & dn)
 {
   _val = dn.value();
   _deriv = dn.derivatives();
+  this->set_derivatives_known_zero(dn.derivatives_known_zero());
   return *this;
 }
 
@@ -91,6 +102,7 @@ DualNumber<T,D>::operator=(const NotADuckDualNumber<T2,D2> & nd_dn)
 {
   _val = nd_dn.value();
   _deriv = nd_dn.derivatives();
+  this->set_derivatives_known_zero(false);
   return *this;
 }
 
@@ -114,6 +126,7 @@ DualNumber<T,D>::operator=(const DualNumberSurrogate<T2,D2> & dns)
   auto size = dns.derivatives().size();
   for (decltype(size) i = 0; i < size; ++i)
     _deriv[i] = *dns.derivatives()[i];
+  this->set_derivatives_known_zero(false);
   return *this;
 }
 
@@ -125,6 +138,7 @@ DualNumber<T,D>::operator=(const T2 & scalar)
 {
   _val = scalar;
   _deriv = 0;
+  this->set_derivatives_known_zero(true);
   return *this;
 }
 
@@ -136,7 +150,10 @@ template <typename T2>
 inline
 DualNumber<T,D>::DualNumber(const T2& val) :
   _val  (DualNumberConstructor<T,D>::value(val)),
-  _deriv(DualNumberConstructor<T,D>::deriv(val)) {}
+  _deriv(DualNumberConstructor<T,D>::deriv(val))
+{
+  this->set_derivatives_known_zero(dual_derivatives_known_zero(val));
+}
 
 template <typename T, typename D>
 template <typename T2, typename D2>
@@ -146,6 +163,38 @@ DualNumber<T,D>::DualNumber(const T2& val,
   _val  (DualNumberConstructor<T,D>::value(val,deriv)),
   _deriv(DualNumberConstructor<T,D>::deriv(val,deriv)) {}
 
+template <typename T, typename D, typename S>
+inline
+typename DualDerivativeCoefficient<T,D,S>::type
+dual_derivative_coefficient (const DualNumber<T,D>&, const S& s)
+{
+  return s;
+}
+
+template <typename D, typename T, typename D2, typename T2>
+inline
+void
+dual_product_update (D& da, const T& a, const D2& db, const T2& b)
+{
+  da = da * b + a * db;
+}
+
+template <typename D, typename T, typename D2, typename T2>
+inline
+void
+dual_quotient_update (D& da, const T& a, const D2& db, const T2& b)
+{
+  da = da / b - db * a / (b * b);
+}
+
+template <typename D, typename T, typename D2, typename T2>
+inline
+void
+dual_reverse_quotient_update (D& db, const T& a, const D2& da, const T2& b)
+{
+  db = da / b - db * a / (b * b);
+}
+
 // FIXME: these operators currently do automatic type promotion when
 // encountering DualNumbers of differing levels of recursion and
 // differentiability.  But what we really want is automatic type
@@ -161,7 +210,10 @@ inline \
 DualNumber<T,D>& \
 DualNumber<T,D>::operator opname##= (const T2& in) \
 { \
-  simplecalc; \
+  if (!this->derivatives_known_zero() && dual_derivatives_enabled()) \
+    { \
+      simplecalc; \
+    } \
   this->value() opname##= in; \
   return *this; \
 } \
@@ -172,6 +224,8 @@ inline \
 DualNumber<T,D>& \
 DualNumber<T,D>::operator opname##= (const DualNumber<T2,D2>& in) \
 { \
+  if (in.derivatives_known_zero() || !dual_derivatives_enabled()) \
+    return *this opname##= in.value(); \
   dualcalc; \
   this->value() opname##= in.value(); \
   return *this; \
@@ -183,7 +237,10 @@ inline \
 DualNumber<T,D> & \
 DualNumber<T,D>::operator opname##= (const NotADuckDualNumber<T2,D2>& in) \
 { \
-  dualcalc; \
+  if (dual_derivatives_enabled()) \
+    { \
+      dualcalc; \
+    } \
   this->value() opname##= in.value(); \
   return *this; \
 } \
@@ -227,12 +284,13 @@ operator opname (const DualNumber<T,D>& a, const T2& b) \
 
 
 
-// With C++11, define "move operations" where possible.  We should be
-// more complete and define the move-from-b alternatives as well, but
-// those would require additional support to correctly handle
-// division, subtraction, or non-commutative addition/multiplication
+// With C++11, define "move operations" where possible.  Moving from
+// b reuses b's derivative storage for the result; rsimplecalc and
+// rdualcalc then update returnval (still holding b's value) to the
+// derivatives of a opname b, which for subtraction and division is
+// not the same update as the in-place operator.
 #if __cplusplus >= 201103L
-#define DualNumber_op(opname, functorname, simplecalc, dualcalc) \
+#define DualNumber_op(opname, functorname, simplecalc, dualcalc, rsimplecalc, rdualcalc) \
         DualNumber_preop(opname, functorname, simplecalc, dualcalc) \
  \
 template <typename T, typename D, typename T2, typename D2> \
@@ -258,29 +316,97 @@ operator opname (DualNumber<T,D>&& a, const T2& b) \
   DS returnval = std::move(a); \
   returnval opname##= b; \
   return returnval; \
+} \
+ \
+template <typename T, typename D, typename T2, typename D2> \
+inline \
+typename functorname##Type<DualNumber<T,D>,DualNumber<T2,D2> >::supertype \
+operator opname (const DualNumber<T,D>& a, DualNumber<T2,D2>&& b) \
+{ \
+  typedef typename \
+    functorname##Type<DualNumber<T,D>,DualNumber<T2,D2> >::supertype \
+    DS; \
+  DS returnval = std::move(b); \
+  if (dual_derivatives_enabled()) \
+    { \
+      rdualcalc; \
+    } \
+  returnval.value() = a.value() opname std::move(returnval.value()); \
+  return returnval; \
+} \
+ \
+template <typename T, typename D, typename T2, typename D2> \
+inline \
+typename functorname##Type<DualNumber<T,D>,DualNumber<T2,D2> >::supertype \
+operator opname (DualNumber<T,D>&& a, DualNumber<T2,D2>&& b) \
+{ \
+  typedef typename \
+    functorname##Type<DualNumber<T,D>,DualNumber<T2,D2> >::supertype \
+    DS; \
+  DS returnval = std::move(a); \
+  returnval opname##= b; \
+  return returnval; \
+} \
+ \
+template <typename T, typename T2, typename D> \
+inline \
+typename functorname##Type<DualNumber<T2,D>,T,true>::supertype \
+operator opname (const T& a, DualNumber<T2,D>&& b) \
+{ \
+  typedef typename \
+    functorname##Type<DualNumber<T2,D>,T,true>::supertype DS; \
+  DS returnval = std::move(b); \
+  if (!returnval.derivatives_known_zero() && dual_derivatives_enabled()) \
+    { \
+      rsimplecalc; \
+    } \
+  returnval.value() = a opname std::move(returnval.value()); \
+  return returnval; \
 }
 
 #else
-#define DualNumber_op(opname, functorname, simplecalc, dualcalc) \
+#define DualNumber_op(opname, functorname, simplecalc, dualcalc, rsimplecalc, rdualcalc) \
         DualNumber_preop(opname, functorname, simplecalc, dualcalc)
 #endif
 
-DualNumber_op(+, Plus, , this->derivatives() += in.derivatives())
+DualNumber_op(+, Plus, ,
+              this->derivatives() += in.derivatives(),
+              ,
+              returnval.derivatives() += a.derivatives())
 
-DualNumber_op(-, Minus, , this->derivatives() -= in.derivatives())
+DualNumber_op(-, Minus, ,
+              this->derivatives() -= in.derivatives(),
+              returnval.derivatives() *= -1,
+              returnval.derivatives() *= -1;
+              returnval.derivatives() += a.derivatives())
 
 DualNumber_op(*,
               Multiplies,
-              this->derivatives() *= in,
-              this->derivatives() = this->derivatives() * in.value() +
-                                    this->value() * in.derivatives())
+              this->derivatives() *= dual_derivative_coefficient(*this, in),
+              dual_product_update(this->derivatives(),
+                                  dual_derivative_coefficient(*this, this->value()),
+                                  in.derivatives(),
+                                  dual_derivative_coefficient(*this, in.value())),
+              returnval.derivatives() *= dual_derivative_coefficient(returnval, a),
+              dual_product_update(returnval.derivatives(),
+                                  dual_derivative_coefficient(returnval, returnval.value()),
+                                  a.derivatives(),
+                                  dual_derivative_coefficient(returnval, a.value())))
 
 DualNumber_op(/,
               Divides,
-              this->derivatives() /= in,
-              this->derivatives() = this->derivatives() / in.value() -
-                                    in.derivatives() * this->value() /
-                                        (in.value() * in.value()))
+              this->derivatives() /= dual_derivative_coefficient(*this, in),
+              dual_quotient_update(this->derivatives(),
+                                   dual_derivative_coefficient(*this, this->value()),
+                                   in.derivatives(),
+                                   dual_derivative_coefficient(*this, in.value())),
+              returnval.derivatives() *= dual_derivative_coefficient(returnval, a);
+              returnval.derivatives() /= dual_derivative_coefficient
+                (returnval, -(returnval.value() * returnval.value())),
+              dual_reverse_quotient_update(returnval.derivatives(),
+                                           dual_derivative_coefficient(returnval, a.value()),
+                                           a.derivatives(),
+                                           dual_derivative_coefficient(returnval, returnval.value())))
 
 
 #define DualNumber_compare(opname)                          \
@@ -331,6 +457,41 @@ D gradient(const DualNumber<T, D>& a)
 {
   return a.derivatives();
 }
+
+
+// pow(a, b) for a builtin exponent b, which needs no b' terms and,
+// for integers and half-integers, no libm calls; one multiplier,
+// b a^(b-1), scales a'.
+template <typename type, typename T, typename D, typename T2>
+inline
+type
+dual_scalar_pow (const DualNumber<T,D>& a, const T2& b, TrueType)
+{
+  typedef typename type::value_type TS;
+  const TS av = a.value();
+
+  TS funcval, dfdx;
+  if (!try_fast_pow(av, b, funcval, dfdx))
+    {
+      const TS bv = b;
+      funcval = std::pow(av, bv);
+      dfdx = bv * std::pow(av, bv - 1);
+    }
+
+  if (a.derivatives_known_zero() || !dual_derivatives_enabled())
+    return type(funcval);
+  return type(funcval, dfdx * a.derivatives());
+}
+
+// Other exponents are promoted to the DualNumber supertype
+template <typename type, typename T, typename D, typename T2>
+inline
+type
+dual_scalar_pow (const DualNumber<T,D>& a, const T2& b, FalseType)
+{
+  type newb(b);
+  return std::pow(a, newb);
+}
 } // namespace MetaPhysicL
 
 
@@ -338,6 +499,9 @@ namespace std {
 
 using MetaPhysicL::DualNumber;
 using MetaPhysicL::CompareTypes;
+using MetaPhysicL::dual_derivatives_enabled;
+using MetaPhysicL::dual_product_update;
+using MetaPhysicL::if_else;
 
 template <typename T, typename D>
 inline bool isnan (const DualNumber<T,D> & a)
@@ -356,7 +520,8 @@ DualNumber<T,D> funcname (const DualNumber<T,D> & in) \
   DualNumber<T,D> returnval = in; \
   T funcval = std::funcname(in.value()); \
   precalc; \
-  returnval.derivatives() *= derivative; \
+  if (!in.derivatives_known_zero() && dual_derivatives_enabled()) \
+    returnval.derivatives() *= derivative; \
   returnval.value() = funcval; \
   return returnval; \
 } \
@@ -367,7 +532,8 @@ DualNumber<T,D> funcname (DualNumber<T,D> && in) \
 { \
   T funcval = std::funcname(in.value()); \
   precalc; \
-  in.derivatives() *= derivative; \
+  if (!in.derivatives_known_zero() && dual_derivatives_enabled()) \
+    in.derivatives() *= derivative; \
   in.value() = funcval; \
   return std::move(in); \
 }
@@ -396,7 +562,8 @@ DualNumber<T,D> funcname (DualNumber<T,D> in) \
 { \
   T funcval = std::funcname(in.value()); \
   precalc; \
-  in.derivatives() *= derivative; \
+  if (!in.derivatives_known_zero() && dual_derivatives_enabled()) \
+    in.derivatives() *= derivative; \
   in.value() = funcval; \
   return std::move(in); \
 }
@@ -549,7 +716,8 @@ DualNumber_complex_std_unary_complex_pre(funcname)
 
 DualNumber_complex_std_unary_complex(conj)
 
-#define DualNumber_std_binary(funcname, derivative) \
+// Overloads with a DualNumber b, then the overload with a scalar b
+#define DualNumber_std_binary_dual_b(funcname, derivative) \
 template <typename T, typename D, typename T2, typename D2> \
 inline \
 typename CompareTypes<DualNumber<T,D>,DualNumber<T2,D2> >::supertype \
@@ -559,6 +727,8 @@ funcname (const DualNumber<T,D>& a, const DualNumber<T2,D2>& b) \
   typedef typename CompareTypes<DualNumber<T,D>,DualNumber<T2,D2> >::supertype type; \
  \
   TS funcval = std::funcname(a.value(), b.value()); \
+  if (!dual_derivatives_enabled()) \
+    return type(funcval); \
   return type(funcval, derivative); \
 } \
  \
@@ -568,6 +738,8 @@ DualNumber<T,D> \
 funcname (const DualNumber<T,D>& a, const DualNumber<T,D>& b) \
 { \
   T funcval = std::funcname(a.value(), b.value()); \
+  if (!dual_derivatives_enabled()) \
+    return DualNumber<T,D>(funcval); \
   return DualNumber<T,D>(funcval, derivative); \
 } \
  \
@@ -579,8 +751,9 @@ funcname (const T& a, const DualNumber<T2,D>& b) \
   typedef typename CompareTypes<DualNumber<T2,D>,T,true>::supertype type; \
   type newa(a); \
   return std::funcname(newa, b); \
-} \
- \
+}
+
+#define DualNumber_std_binary_scalar_b(funcname) \
 template <typename T, typename T2, typename D> \
 inline \
 typename CompareTypes<DualNumber<T,D>,T2>::supertype \
@@ -591,6 +764,187 @@ funcname (const DualNumber<T,D>& a, const T2& b) \
   return std::funcname(a, newb); \
 }
 
+#define DualNumber_std_binary(funcname, derivative) \
+DualNumber_std_binary_dual_b(funcname, derivative) \
+DualNumber_std_binary_scalar_b(funcname)
+
+// With C++11, binary functions of a temporary DualNumber can write
+// into the temporary's derivatives rather than building new ones.
+// Functions whose derivative is a linear combination of the argument
+// derivatives (dacoef * a' + dbcoef * b') use the same fused
+// dual_product_update as multiplication, falling back on the copying
+// versions wherever linear_ok fails.
+#if __cplusplus >= 201103L
+#define DualNumber_std_binary_move_linear_dual_b(funcname, dacoef, dbcoef, linear_ok) \
+template <typename T, typename D> \
+inline \
+DualNumber<T,D> \
+funcname (DualNumber<T,D>&& a, const DualNumber<T,D>& b) \
+{ \
+  const T& av = a.value(); \
+  const T& bv = b.value(); \
+  if (!(linear_ok)) \
+    return std::funcname(static_cast<const DualNumber<T,D>&>(a), b); \
+  T funcval = std::funcname(av, bv); \
+  if (dual_derivatives_enabled()) \
+    dual_product_update(a.derivatives(), T(dbcoef), b.derivatives(), T(dacoef)); \
+  a.value() = funcval; \
+  return std::move(a); \
+} \
+ \
+template <typename T, typename D> \
+inline \
+DualNumber<T,D> \
+funcname (const DualNumber<T,D>& a, DualNumber<T,D>&& b) \
+{ \
+  const T& av = a.value(); \
+  const T& bv = b.value(); \
+  if (!(linear_ok)) \
+    return std::funcname(a, static_cast<const DualNumber<T,D>&>(b)); \
+  T funcval = std::funcname(av, bv); \
+  if (dual_derivatives_enabled()) \
+    dual_product_update(b.derivatives(), T(dacoef), a.derivatives(), T(dbcoef)); \
+  b.value() = funcval; \
+  return std::move(b); \
+} \
+ \
+template <typename T, typename D> \
+inline \
+DualNumber<T,D> \
+funcname (DualNumber<T,D>&& a, DualNumber<T,D>&& b) \
+{ \
+  return std::funcname(std::move(a), static_cast<const DualNumber<T,D>&>(b)); \
+} \
+ \
+template <typename T, typename T2, typename D> \
+inline \
+typename MetaPhysicL::boostcopy::enable_if<MetaPhysicL::BuiltinTraits<T>, \
+  typename CompareTypes<DualNumber<T2,D>,T,true>::supertype>::type \
+funcname (const T& a, DualNumber<T2,D>&& b) \
+{ \
+  typedef typename CompareTypes<DualNumber<T2,D>,T,true>::supertype type; \
+  typedef typename type::value_type TS; \
+  const TS av = a; \
+  { \
+    const T2& bv = b.value(); \
+    (void)bv; /* linear_ok may depend on av alone */ \
+    if (!(linear_ok)) \
+      return std::funcname(a, static_cast<const DualNumber<T2,D>&>(b)); \
+  } \
+  type returnval = std::move(b); \
+  const TS& bv = returnval.value(); \
+  TS funcval = std::funcname(av, bv); \
+  if (dual_derivatives_enabled()) \
+    returnval.derivatives() *= TS(dbcoef); \
+  returnval.value() = funcval; \
+  return returnval; \
+}
+
+#define DualNumber_std_binary_move_linear_scalar_b(funcname, dacoef) \
+template <typename T, typename T2, typename D> \
+inline \
+typename MetaPhysicL::boostcopy::enable_if<MetaPhysicL::BuiltinTraits<T2>, \
+  typename CompareTypes<DualNumber<T,D>,T2>::supertype>::type \
+funcname (DualNumber<T,D>&& a, const T2& b) \
+{ \
+  typedef typename CompareTypes<DualNumber<T,D>,T2>::supertype type; \
+  typedef typename type::value_type TS; \
+  type returnval = std::move(a); \
+  const TS& av = returnval.value(); \
+  const TS bv = b; \
+  TS funcval = std::funcname(av, bv); \
+  if (dual_derivatives_enabled()) \
+    returnval.derivatives() *= TS(dacoef); \
+  returnval.value() = funcval; \
+  return returnval; \
+}
+
+#define DualNumber_std_binary_move_linear(funcname, dacoef, dbcoef, linear_ok) \
+DualNumber_std_binary_move_linear_dual_b(funcname, dacoef, dbcoef, linear_ok) \
+DualNumber_std_binary_move_linear_scalar_b(funcname, dacoef)
+
+// Functions whose derivative is just that of one argument or the
+// other, selecting a' wherever choose_a holds.
+#define DualNumber_std_binary_move_select(funcname, choose_a) \
+template <typename T, typename D> \
+inline \
+DualNumber<T,D> \
+funcname (DualNumber<T,D>&& a, const DualNumber<T,D>& b) \
+{ \
+  const T& av = a.value(); \
+  const T& bv = b.value(); \
+  T funcval = std::funcname(av, bv); \
+  if (!(choose_a) && dual_derivatives_enabled()) \
+    a.derivatives() = b.derivatives(); \
+  a.value() = funcval; \
+  return std::move(a); \
+} \
+ \
+template <typename T, typename D> \
+inline \
+DualNumber<T,D> \
+funcname (const DualNumber<T,D>& a, DualNumber<T,D>&& b) \
+{ \
+  const T& av = a.value(); \
+  const T& bv = b.value(); \
+  T funcval = std::funcname(av, bv); \
+  if ((choose_a) && dual_derivatives_enabled()) \
+    b.derivatives() = a.derivatives(); \
+  b.value() = funcval; \
+  return std::move(b); \
+} \
+ \
+template <typename T, typename D> \
+inline \
+DualNumber<T,D> \
+funcname (DualNumber<T,D>&& a, DualNumber<T,D>&& b) \
+{ \
+  const T& av = a.value(); \
+  const T& bv = b.value(); \
+  T funcval = std::funcname(av, bv); \
+  if (!(choose_a) && dual_derivatives_enabled()) \
+    a.derivatives() = std::move(b.derivatives()); \
+  a.value() = funcval; \
+  return std::move(a); \
+} \
+ \
+template <typename T, typename T2, typename D> \
+inline \
+typename MetaPhysicL::boostcopy::enable_if<MetaPhysicL::BuiltinTraits<T>, \
+  typename CompareTypes<DualNumber<T2,D>,T,true>::supertype>::type \
+funcname (const T& a, DualNumber<T2,D>&& b) \
+{ \
+  typedef typename CompareTypes<DualNumber<T2,D>,T,true>::supertype type; \
+  typedef typename type::value_type TS; \
+  type returnval = std::move(b); \
+  const TS av = a; \
+  const TS& bv = returnval.value(); \
+  TS funcval = std::funcname(av, bv); \
+  if ((choose_a) && dual_derivatives_enabled()) \
+    returnval.derivatives() = 0; \
+  returnval.value() = funcval; \
+  return returnval; \
+} \
+ \
+template <typename T, typename T2, typename D> \
+inline \
+typename MetaPhysicL::boostcopy::enable_if<MetaPhysicL::BuiltinTraits<T2>, \
+  typename CompareTypes<DualNumber<T,D>,T2>::supertype>::type \
+funcname (DualNumber<T,D>&& a, const T2& b) \
+{ \
+  typedef typename CompareTypes<DualNumber<T,D>,T2>::supertype type; \
+  typedef typename type::value_type TS; \
+  type returnval = std::move(a); \
+  const TS& av = returnval.value(); \
+  const TS bv = b; \
+  TS funcval = std::funcname(av, bv); \
+  if (!(choose_a) && dual_derivatives_enabled()) \
+    returnval.derivatives() = 0; \
+  returnval.value() = funcval; \
+  return returnval; \
+}
+#endif // __cplusplus >= 201103L
+
 #define DualNumber_equiv_binary(funcname, equivalent) \
 template <typename T, typename D, typename T2, typename D2> \
 inline \
@@ -630,10 +984,24 @@ DualNumber_equiv_binary(funcname##l, funcname)
 
 
 // if_else is necessary here to handle cases where a is negative but b
-// is 0; we should have a contribution of 0 from those, not NaN.
-DualNumber_std_binary(pow,
+// is 0; we should have a contribution of 0 from those, not NaN.  It is
+// called unqualified so that overloads for derivative types declared
+// after this header are still found.
+DualNumber_std_binary_dual_b(pow,
   std::pow(a.value(), b.value() - 1) * (b.value() * a.derivatives() +
-  MetaPhysicL::if_else(b.derivatives(), b.derivatives() * std::log(a.value()) * a.value(), b.derivatives())))
+  if_else(b.derivatives(), b.derivatives() * std::log(a.value()) * a.value(), b.derivatives())))
+
+template <typename T, typename T2, typename D>
+inline
+typename CompareTypes<DualNumber<T,D>,T2>::supertype
+pow (const DualNumber<T,D>& a, const T2& b)
+{
+  typedef typename CompareTypes<DualNumber<T,D>,T2>::supertype type;
+  return MetaPhysicL::dual_scalar_pow<type>
+    (a, b, typename MetaPhysicL::IfElse<MetaPhysicL::BuiltinTraits<T2>::value,
+                                        MetaPhysicL::TrueType,
+                                        MetaPhysicL::FalseType>::type());
+}
 DualNumber_std_binary(atan2,
   (b.value() * a.derivatives() - a.value() * b.derivatives()) /
   (b.value() * b.value() + a.value() * a.value()))
@@ -660,6 +1028,44 @@ DualNumber_std_binary(hypot, (a.value()*a.derivatives() +
                               hypot(a.value(), b.value()))
 DualNumber_equivfl_binary(hypot)
 DualNumber_equivfl_binary(atan2)
+
+// pow needs a > 0 for the log(a) coefficient; the copying version
+// handles the other cases, where b' may be zero.
+DualNumber_std_binary_move_linear_dual_b(pow, bv * std::pow(av, bv - 1),
+                                         std::log(av) * funcval, av > 0)
+
+template <typename T, typename T2, typename D>
+inline
+typename MetaPhysicL::boostcopy::enable_if<MetaPhysicL::BuiltinTraits<T2>,
+  typename CompareTypes<DualNumber<T,D>,T2>::supertype>::type
+pow (DualNumber<T,D>&& a, const T2& b)
+{
+  typedef typename CompareTypes<DualNumber<T,D>,T2>::supertype type;
+  typedef typename type::value_type TS;
+  type returnval = std::move(a);
+  const TS& av = returnval.value();
+
+  TS funcval, dfdx;
+  if (!MetaPhysicL::try_fast_pow(av, b, funcval, dfdx))
+    {
+      const TS bv = b;
+      funcval = std::pow(av, bv);
+      dfdx = bv * std::pow(av, bv - 1);
+    }
+
+  if (!returnval.derivatives_known_zero() && dual_derivatives_enabled())
+    returnval.derivatives() *= dfdx;
+  returnval.value() = funcval;
+  return returnval;
+}
+DualNumber_std_binary_move_linear(atan2, bv / (bv * bv + av * av),
+                                  -av / (bv * bv + av * av), true)
+DualNumber_std_binary_move_select(max, av > bv)
+DualNumber_std_binary_move_select(min, !(av > bv))
+DualNumber_std_binary_move_select(fmod, true)
+DualNumber_std_binary_move_select(remainder, true)
+DualNumber_std_binary_move_linear(fdim, av > bv, -(av > bv), true)
+DualNumber_std_binary_move_linear(hypot, av / funcval, bv / funcval, true)
 #endif // __cplusplus >= 201103L
 
 } // namespace std
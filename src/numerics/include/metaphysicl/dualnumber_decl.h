@@ -33,7 +33,9 @@
 #include <limits>
 
 #include "metaphysicl/compare_types.h"
+#include "metaphysicl/ct_types.h" // for IfElse
 #include "metaphysicl/dualderivatives.h"
+#include "metaphysicl/dualvaluesonly.h"
 #include "metaphysicl/raw_type.h"
 #include "metaphysicl/testable.h"
 
@@ -44,8 +46,39 @@ class NotADuckDualNumber;
 template <typename T, typename D>
 class DualNumberSurrogate;
 
+// Dense derivative types can't represent a constant any more cheaply
+// than a variable, so DualNumber keeps a hint for them that its
+// derivatives are known to be identically zero, set by construction
+// or assignment from a scalar.  Arithmetic on such constants takes the
+// scalar path.  Any non-const access to the derivatives clears the
+// hint, so it is never stale; it may only be conservatively false.
+template <bool enabled>
+class DualNumberZeroHint
+{
+public:
+  bool derivatives_known_zero() const { return _known_zero; }
+
+protected:
+  void set_derivatives_known_zero(bool known_zero) { _known_zero = known_zero; }
+
+private:
+  bool _known_zero = false;
+};
+
+template <>
+class DualNumberZeroHint<false>
+{
+public:
+  static bool derivatives_known_zero() { return false; }
+
+protected:
+  void set_derivatives_known_zero(bool) {}
+};
+
 template <typename T, typename D=T>
-class DualNumber : public safe_bool<DualNumber<T,D> >
+class DualNumber : public safe_bool<DualNumber<T,D> >,
+                   public DualNumberZeroHint<BuiltinTraits<T>::value &&
+                                             DenseTraits<D>::value>
 {
 public:
   typedef T value_type;
@@ -145,6 +178,21 @@ private:
   D _deriv;
 };
 
+// Whether a DualNumber constructed from v has zero derivatives
+template <typename T2>
+inline
+bool dual_derivatives_known_zero(const T2&)
+{
+  return BuiltinTraits<T2>::value;
+}
+
+template <typename T2, typename D2>
+inline
+bool dual_derivatives_known_zero(const DualNumber<T2,D2>& v)
+{
+  return v.derivatives_known_zero();
+}
+
 // Helper class to handle partial specialization for DualNumber
 // constructors
 
@@ -199,6 +247,29 @@ struct DualNumberConstructor<DualNumber<T,D>, DD>
   static DD deriv(const T2&, const D2& d) { return d; }
 };
 
+// Product and quotient rule updates for DualNumber derivatives:
+// dual_product_update sets da = da * b + a * db,
+// dual_quotient_update sets da = da / b - db * a / (b * b), and
+// dual_reverse_quotient_update sets db = da / b - db * a / (b * b).
+// Derivative types which can do these updates in place (e.g. the
+// dynamically sparse types, which would otherwise allocate several
+// temporaries per operation) overload them.
+
+template <typename D, typename T, typename D2, typename T2>
+inline
+void
+dual_product_update (D& da, const T& a, const D2& db, const T2& b);
+
+template <typename D, typename T, typename D2, typename T2>
+inline
+void
+dual_quotient_update (D& da, const T& a, const D2& db, const T2& b);
+
+template <typename D, typename T, typename D2, typename T2>
+inline
+void
+dual_reverse_quotient_update (D& db, const T& a, const D2& da, const T2& b);
+
 // FIXME: these operators currently do automatic type promotion when
 // encountering DualNumbers of differing levels of recursion and
 // differentiability.  But what we really want is automatic type
@@ -227,10 +298,8 @@ operator opname (const DualNumber<T,D>& a, const T2& b);
 
 
 
-// With C++11, define "move operations" where possible.  We should be
-// more complete and define the move-from-b alternatives as well, but
-// those would require additional support to correctly handle
-// division, subtraction, or non-commutative addition/multiplication
+// With C++11, define "move operations" where possible, reusing the
+// storage of whichever operand is an rvalue.
 #if __cplusplus >= 201103L
 #define DualNumber_decl_op(opname, functorname) \
         DualNumber_decl_preop(opname, functorname) \
@@ -245,6 +314,24 @@ template <typename T, typename D, typename T2> \
 inline \
 typename functorname##Type<DualNumber<T,D>,T2,false>::supertype \
 operator opname (DualNumber<T,D>&& a, const T2& b); \
+ \
+ \
+template <typename T, typename D, typename T2, typename D2> \
+inline \
+typename functorname##Type<DualNumber<T,D>,DualNumber<T2,D2> >::supertype \
+operator opname (const DualNumber<T,D>& a, DualNumber<T2,D2>&& b); \
+ \
+ \
+template <typename T, typename D, typename T2, typename D2> \
+inline \
+typename functorname##Type<DualNumber<T,D>,DualNumber<T2,D2> >::supertype \
+operator opname (DualNumber<T,D>&& a, DualNumber<T2,D2>&& b); \
+ \
+ \
+template <typename T, typename T2, typename D> \
+inline \
+typename functorname##Type<DualNumber<T2,D>,T,true>::supertype \
+operator opname (const T& a, DualNumber<T2,D>&& b);
 
 #else
 #define DualNumber_decl_op(opname, functorname) \
@@ -295,6 +382,57 @@ std::ostream&
 operator<< (std::ostream& output, const DualNumber<T,D>& a);
 
 
+// Mixed precision DualNumber types store derivatives at lower
+// precision than their values, e.g. DualNumber<double,
+// NumberArray<N,float> >.  Arithmetic on them computes in the value
+// precision, converting derivative entries as they are loaded and
+// stored, and keeps D as the derivative type of the result:
+//
+//   mixed op mixed (same type)   -> the same mixed type
+//   mixed op builtin scalar      -> the same derivative storage
+//   mixed op full precision dual -> the full precision dual
+//
+// Builtin floating point entry types narrower than the value type are
+// detected automatically; other storage types can opt in by
+// specializing this.
+template <typename T, typename D>
+struct ReducedPrecisionDerivatives
+{
+  typedef typename ValueType<D>::type entry_type;
+
+  static const bool value =
+    BuiltinTraits<T>::value && BuiltinTraits<entry_type>::value &&
+    !std::numeric_limits<entry_type>::is_integer &&
+    std::numeric_limits<entry_type>::digits < std::numeric_limits<T>::digits;
+};
+
+// The derivative type of an arithmetic result: the promoted type
+// CompareTypes would give, unless D is reduced precision storage
+template <typename T, typename D, typename Promoted>
+struct DualDerivativeStorage
+{
+  typedef typename IfElse<ReducedPrecisionDerivatives<T,D>::value,
+                          D, Promoted>::type type;
+};
+
+// The type in which a builtin coefficient S scales the derivatives of
+// a DualNumber<T,D> in arithmetic operators: rounded once to the entry
+// type for reduced precision storage, so that those derivatives are
+// updated at their storage precision, and passed through otherwise.
+template <typename T, typename D, typename S>
+struct DualDerivativeCoefficient
+{
+  typedef typename IfElse<ReducedPrecisionDerivatives<T,D>::value &&
+                          BuiltinTraits<S>::value,
+                          const typename ValueType<D>::type,
+                          const S&>::type type;
+};
+
+template <typename T, typename D, typename S>
+inline
+typename DualDerivativeCoefficient<T,D,S>::type
+dual_derivative_coefficient (const DualNumber<T,D>&, const S& s);
+
 // ScalarTraits, RawType, CompareTypes specializations
 
 template <typename T, typename D>
@@ -353,7 +491,9 @@ template<typename T, typename T2, typename D, bool reverseorder>
 struct MultipliesType<DualNumber<T, D>, T2, reverseorder,
                       typename boostcopy::enable_if<BuiltinTraits<T2> >::type> {
   typedef DualNumber<typename SymmetricMultipliesType<T, T2, reverseorder>::supertype,
-                     typename SymmetricMultipliesType<D, T2, reverseorder>::supertype> supertype;
+                     typename DualDerivativeStorage<T, D,
+                       typename SymmetricMultipliesType<D, T2, reverseorder>::supertype
+                     >::type> supertype;
 };
 
 template<typename T, typename D, typename T2, typename D2, bool reverseorder>
@@ -368,8 +508,9 @@ struct MultipliesType<DualNumber<T, D>, DualNumber<T2, D2>, reverseorder> {
 template<typename T, typename D, bool reverseorder>
 struct MultipliesType<DualNumber<T, D>, DualNumber<T, D>, reverseorder> {
   typedef DualNumber<typename SymmetricMultipliesType<T, T, reverseorder>::supertype,
-                     typename SymmetricMultipliesType<T, D, reverseorder>::supertype
-                     > supertype;
+                     typename DualDerivativeStorage<T, D,
+                       typename SymmetricMultipliesType<T, D, reverseorder>::supertype
+                     >::type> supertype;
 };
 
 
@@ -377,18 +518,21 @@ template<typename T, typename T2, typename D>
 struct DividesType<DualNumber<T, D>, T2, false,
                       typename boostcopy::enable_if<BuiltinTraits<T2> >::type> {
   typedef DualNumber<typename SymmetricDividesType<T, T2>::supertype,
-                     typename SymmetricDividesType<D, T2>::supertype> supertype;
+                     typename DualDerivativeStorage<T, D,
+                       typename SymmetricDividesType<D, T2>::supertype
+                     >::type> supertype;
 };
 
 template<typename T, typename D, typename T2>
 struct DividesType<DualNumber<T, D>, T2, true,
                    typename boostcopy::enable_if<BuiltinTraits<T2> >::type> {
   typedef DualNumber<typename SymmetricDividesType<T2, T>::supertype,
-                     typename SymmetricDividesType<
-                       typename SymmetricMultipliesType<T2, D>::supertype,
-                       T
-                     >::supertype
-                    > supertype;
+                     typename DualDerivativeStorage<T, D,
+                       typename SymmetricDividesType<
+                         typename SymmetricMultipliesType<T2, D>::supertype,
+                         T
+                       >::supertype
+                     >::type> supertype;
 };
 
 
@@ -413,14 +557,15 @@ struct DividesType<DualNumber<T, D>, DualNumber<T2, D2>, true> {
 template<typename T, typename D>
 struct DividesType<DualNumber<T, D>, DualNumber<T, D>, false> {
   typedef DualNumber<T,
-                     typename SymmetricMinusType<
-                       typename SymmetricDividesType<T, D>::supertype,
-                       typename SymmetricDividesType<
-                         typename SymmetricMultipliesType<T, D>::supertype,
-                         T
+                     typename DualDerivativeStorage<T, D,
+                       typename SymmetricMinusType<
+                         typename SymmetricDividesType<T, D>::supertype,
+                         typename SymmetricDividesType<
+                           typename SymmetricMultipliesType<T, D>::supertype,
+                           T
+                         >::supertype
                        >::supertype
-                     >::supertype
-                    > supertype;
+                     >::type> supertype;
 };
 
 template<typename T, typename D>
@@ -471,10 +616,12 @@ template<typename T, typename T2, typename D, bool reverseorder>
 struct CompareTypes<DualNumber<T, D>, T2, reverseorder,
                     typename boostcopy::enable_if<BuiltinTraits<T2> >::type> {
   typedef DualNumber<typename SymmetricCompareTypes<T, T2>::supertype,
-                     typename SymmetricCompareTypes<
-                       typename SymmetricCompareTypes<D, T2>::supertype,
-                       T
-                     >::supertype> supertype;
+                     typename DualDerivativeStorage<T, D,
+                       typename SymmetricCompareTypes<
+                         typename SymmetricCompareTypes<D, T2>::supertype,
+                         T
+                       >::supertype
+                     >::type> supertype;
 };
 
 template<typename T, typename D, typename T2, typename D2>
@@ -489,7 +636,10 @@ struct CompareTypes<DualNumber<T, D>, DualNumber<T2, D2> > {
 
 template<typename T, typename D>
 struct CompareTypes<DualNumber<T, D>, DualNumber<T, D> > {
-  typedef DualNumber<T, typename SymmetricCompareTypes<T, D>::supertype> supertype;
+  typedef DualNumber<T,
+                     typename DualDerivativeStorage<T, D,
+                       typename SymmetricCompareTypes<T, D>::supertype
+                     >::type> supertype;
 };
 
 
@@ -690,6 +840,49 @@ DualNumber_decl_std_binary(funcname##l)
 DualNumber_decl_std_binary(funcname) \
 DualNumber_decl_fl_binary(funcname)
 
+#if __cplusplus >= 201103L
+#define DualNumber_decl_std_binary_move(funcname) \
+template <typename T, typename D> \
+inline \
+DualNumber<T,D> \
+funcname (DualNumber<T,D>&& a, const DualNumber<T,D>& b); \
+ \
+ \
+template <typename T, typename D> \
+inline \
+DualNumber<T,D> \
+funcname (const DualNumber<T,D>& a, DualNumber<T,D>&& b); \
+ \
+ \
+template <typename T, typename D> \
+inline \
+DualNumber<T,D> \
+funcname (DualNumber<T,D>&& a, DualNumber<T,D>&& b); \
+ \
+ \
+template <typename T, typename T2, typename D> \
+inline \
+typename MetaPhysicL::boostcopy::enable_if<MetaPhysicL::BuiltinTraits<T>, \
+  typename CompareTypes<DualNumber<T2,D>,T,true>::supertype>::type \
+funcname (const T& a, DualNumber<T2,D>&& b); \
+ \
+ \
+template <typename T, typename T2, typename D> \
+inline \
+typename MetaPhysicL::boostcopy::enable_if<MetaPhysicL::BuiltinTraits<T2>, \
+  typename CompareTypes<DualNumber<T,D>,T2>::supertype>::type \
+funcname (DualNumber<T,D>&& a, const T2& b);
+
+DualNumber_decl_std_binary_move(pow)
+DualNumber_decl_std_binary_move(atan2)
+DualNumber_decl_std_binary_move(max)
+DualNumber_decl_std_binary_move(min)
+DualNumber_decl_std_binary_move(fmod)
+DualNumber_decl_std_binary_move(remainder)
+DualNumber_decl_std_binary_move(fdim)
+DualNumber_decl_std_binary_move(hypot)
+#endif // __cplusplus >= 201103L
+
 DualNumber_decl_std_binary(pow)
 DualNumber_decl_std_binary(atan2)
 DualNumber_decl_std_binary(max)
@@ -149,4 +149,145 @@ DualNumberArray_comparisons(OrType);
 
 } // namespace MetaPhysicL
 
+
+namespace std {
+
+using MetaPhysicL::DualNumber;
+using MetaPhysicL::NumberArray;
+
+// With METAPHYSICL_SIMD_MATH, arrays of floating point values get
+// their function values and derivative factors from a single pass of
+// the vectorized kernels; as for a single DualNumber, derivatives
+// known to be zero or switched off are left alone
+#ifdef METAPHYSICL_SIMD_MATH
+
+#define DualNumberArray_simd_unary_T(funcname, T) \
+template <std::size_t N, typename D> \
+inline \
+DualNumber<NumberArray<N, T>, D> \
+funcname (DualNumber<NumberArray<N, T>, D> in) \
+{ \
+  NumberArray<N, T> factor; \
+  MetaPhysicL::SIMDMath::funcname(N, &in.value()[0], &in.value()[0], \
+                                  &factor[0]); \
+  if (!in.derivatives_known_zero() && dual_derivatives_enabled()) \
+    in.derivatives() *= factor; \
+  return in; \
+} \
+ \
+template <std::size_t N, typename D> \
+inline \
+NumberArray<N, DualNumber<T, D> > \
+funcname (NumberArray<N, DualNumber<T, D> > a) \
+{ \
+  T values[N], factors[N]; \
+  for (std::size_t i=0; i != N; ++i) \
+    values[i] = a[i].value(); \
+ \
+  MetaPhysicL::SIMDMath::funcname(N, values, values, factors); \
+ \
+  const bool derivatives = dual_derivatives_enabled(); \
+  for (std::size_t i=0; i != N; ++i) \
+    { \
+      a[i].value() = values[i]; \
+      if (derivatives && !a[i].derivatives_known_zero()) \
+        a[i].derivatives() *= factors[i]; \
+    } \
+  return a; \
+}
+
+#define DualNumberArray_simd_unary(funcname) \
+DualNumberArray_simd_unary_T(funcname, double) \
+DualNumberArray_simd_unary_T(funcname, float)
+
+#define DualNumberArray_simd_binary_T(funcname, T) \
+template <std::size_t N, typename D> \
+inline \
+DualNumber<NumberArray<N, T>, D> \
+funcname (DualNumber<NumberArray<N, T>, D> a, \
+          DualNumber<NumberArray<N, T>, D> b) \
+{ \
+  NumberArray<N, T> dfda, dfdb; \
+  MetaPhysicL::SIMDMath::funcname(N, &a.value()[0], &b.value()[0], \
+                                  &a.value()[0], &dfda[0], &dfdb[0]); \
+  if (!dual_derivatives_enabled()) \
+    return a; \
+  if (a.derivatives_known_zero()) \
+    { \
+      b.value() = a.value(); \
+      if (!b.derivatives_known_zero()) \
+        b.derivatives() *= dfdb; \
+      return b; \
+    } \
+  a.derivatives() *= dfda; \
+  if (!b.derivatives_known_zero()) \
+    { \
+      b.derivatives() *= dfdb; \
+      a.derivatives() += b.derivatives(); \
+    } \
+  return a; \
+} \
+ \
+template <std::size_t N, typename D> \
+inline \
+NumberArray<N, DualNumber<T, D> > \
+funcname (const NumberArray<N, DualNumber<T, D> >& a, \
+          const NumberArray<N, DualNumber<T, D> >& b) \
+{ \
+  T a_values[N], b_values[N], values[N], dfda[N], dfdb[N]; \
+  for (std::size_t i=0; i != N; ++i) \
+    { \
+      a_values[i] = a[i].value(); \
+      b_values[i] = b[i].value(); \
+    } \
+ \
+  MetaPhysicL::SIMDMath::funcname(N, a_values, b_values, values, dfda, dfdb); \
+ \
+  const bool derivatives = dual_derivatives_enabled(); \
+  NumberArray<N, DualNumber<T, D> > returnval; \
+  for (std::size_t i=0; i != N; ++i) \
+    { \
+      returnval[i] = values[i]; \
+      if (!derivatives) \
+        continue; \
+      if (!a[i].derivatives_known_zero()) \
+        { \
+          returnval[i].derivatives() = a[i].derivatives(); \
+          returnval[i].derivatives() *= dfda[i]; \
+          if (!b[i].derivatives_known_zero()) \
+            { \
+              D b_deriv = b[i].derivatives(); \
+              b_deriv *= dfdb[i]; \
+              returnval[i].derivatives() += b_deriv; \
+            } \
+        } \
+      else if (!b[i].derivatives_known_zero()) \
+        { \
+          returnval[i].derivatives() = b[i].derivatives(); \
+          returnval[i].derivatives() *= dfdb[i]; \
+        } \
+    } \
+  return returnval; \
+}
+
+#define DualNumberArray_simd_binary(funcname) \
+DualNumberArray_simd_binary_T(funcname, double) \
+DualNumberArray_simd_binary_T(funcname, float)
+
+DualNumberArray_simd_unary(exp)
+DualNumberArray_simd_unary(log)
+DualNumberArray_simd_unary(sin)
+DualNumberArray_simd_unary(cos)
+DualNumberArray_simd_unary(tanh)
+DualNumberArray_simd_unary(sqrt)
+DualNumberArray_simd_binary(atan2)
+
+#if __cplusplus >= 201103L
+DualNumberArray_simd_unary(erf)
+DualNumberArray_simd_binary(hypot)
+#endif // __cplusplus >= 201103L
+#endif // METAPHYSICL_SIMD_MATH
+
+} // namespace std
+
 #endif // METAPHYSICL_DUALNUMBERARRAY_H
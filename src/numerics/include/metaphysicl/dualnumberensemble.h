@@ -0,0 +1,297 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// MetaPhysicL - A metaprogramming library for physics calculations
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+//
+// $Id$
+//
+//--------------------------------------------------------------------------
+
+
+#ifndef METAPHYSICL_DUALNUMBERENSEMBLE_H
+#define METAPHYSICL_DUALNUMBERENSEMBLE_H
+
+
+#include "metaphysicl/dualnumberensemble_decl.h"
+#include "metaphysicl/dualnumberarray.h"
+
+
+namespace MetaPhysicL {
+
+template <std::size_t N, typename T, typename S>
+inline
+void
+ensemble_insert (NumberArray<N,T>& a, std::size_t l, const NumberArray<N,S>& val)
+{
+  for (std::size_t i=0; i != N; ++i)
+    ensemble_insert(a[i], l, val[i]);
+}
+
+template <std::size_t N, typename T, typename S>
+inline
+void
+ensemble_extract (const NumberArray<N,T>& a, std::size_t l, NumberArray<N,S>& val)
+{
+  for (std::size_t i=0; i != N; ++i)
+    ensemble_extract(a[i], l, val[i]);
+}
+
+template <std::size_t N, typename T, std::size_t W, typename B, typename T2>
+inline
+void
+ensemble_blend (NumberArray<N,T>& a, const NumberEnsemble<W,B>& mask,
+                const NumberArray<N,T2>& b)
+{
+  for (std::size_t i=0; i != N; ++i)
+    ensemble_blend(a[i], mask, b[i]);
+}
+
+template <std::size_t N, typename T, std::size_t W, typename B, typename T2>
+inline
+void
+ensemble_blend (NumberArray<N,T>& a, const NumberEnsemble<W,B>& mask,
+                const T2& b)
+{
+  for (std::size_t i=0; i != N; ++i)
+    ensemble_blend(a[i], mask, b);
+}
+
+
+template <typename T, typename D, typename S, typename SD>
+inline
+void
+ensemble_insert (DualNumber<T,D>& a, std::size_t l, const DualNumber<S,SD>& val)
+{
+  ensemble_insert(a.value(), l, val.value());
+  ensemble_insert(a.derivatives(), l, val.derivatives());
+}
+
+template <typename T, typename D, typename S, typename SD>
+inline
+void
+ensemble_extract (const DualNumber<T,D>& a, std::size_t l, DualNumber<S,SD>& val)
+{
+  ensemble_extract(a.value(), l, val.value());
+  ensemble_extract(a.derivatives(), l, val.derivatives());
+}
+
+template <typename T, typename D, std::size_t W, typename B, typename T2, typename D2>
+inline
+void
+ensemble_blend (DualNumber<T,D>& a, const NumberEnsemble<W,B>& mask,
+                const DualNumber<T2,D2>& b)
+{
+  ensemble_blend(a.value(), mask, b.value());
+  ensemble_blend(a.derivatives(), mask, b.derivatives());
+}
+
+// Non-DualNumber values have zero derivatives
+template <typename T, typename D, std::size_t W, typename B, typename T2>
+inline
+void
+ensemble_blend (DualNumber<T,D>& a, const NumberEnsemble<W,B>& mask,
+                const T2& b)
+{
+  ensemble_blend(a.value(), mask, b);
+  ensemble_blend(a.derivatives(), mask, 0);
+}
+
+
+// Comparisons of DualNumber ensembles return masks rather than bool
+
+#define DualNumberEnsemble_compare(opname) \
+template <std::size_t W, typename T, typename D, typename T2, typename D2> \
+inline \
+NumberEnsemble<W, bool> \
+operator opname (const DualNumber<NumberEnsemble<W,T>,D>& a, \
+                 const DualNumber<NumberEnsemble<W,T2>,D2>& b) \
+{ \
+  return (a.value() opname b.value()); \
+} \
+ \
+template <std::size_t W, typename T, typename T2, typename D2> \
+inline \
+typename boostcopy::enable_if_class< \
+  typename CompareTypes<DualNumber<NumberEnsemble<W,T2>,D2>,T>::supertype, \
+  NumberEnsemble<W, bool> \
+>::type \
+operator opname (const T& a, const DualNumber<NumberEnsemble<W,T2>,D2>& b) \
+{ \
+  return (a opname b.value()); \
+} \
+ \
+template <std::size_t W, typename T, typename D, typename T2> \
+inline \
+typename boostcopy::enable_if_class< \
+  typename CompareTypes<DualNumber<NumberEnsemble<W,T>,D>,T2>::supertype, \
+  NumberEnsemble<W, bool> \
+>::type \
+operator opname (const DualNumber<NumberEnsemble<W,T>,D>& a, const T2& b) \
+{ \
+  return (a.value() opname b); \
+}
+
+DualNumberEnsemble_compare(>)
+DualNumberEnsemble_compare(>=)
+DualNumberEnsemble_compare(<)
+DualNumberEnsemble_compare(<=)
+DualNumberEnsemble_compare(==)
+DualNumberEnsemble_compare(!=)
+DualNumberEnsemble_compare(&&)
+DualNumberEnsemble_compare(||)
+
+} // namespace MetaPhysicL
+
+
+namespace std {
+
+using MetaPhysicL::DualNumber;
+using MetaPhysicL::NumberEnsemble;
+
+// Ensembles select each lane's derivatives rather than branching.
+// Temporaries gain nothing here and share the copying versions.
+#define DualNumberEnsemble_std_binary_moves(funcname) \
+template <std::size_t W, typename T, typename D> \
+inline \
+DualNumber<NumberEnsemble<W,T>,D> \
+funcname (DualNumber<NumberEnsemble<W,T>,D>&& a, const DualNumber<NumberEnsemble<W,T>,D>& b) \
+{ \
+  return std::funcname(static_cast<const DualNumber<NumberEnsemble<W,T>,D>&>(a), b); \
+} \
+ \
+template <std::size_t W, typename T, typename D> \
+inline \
+DualNumber<NumberEnsemble<W,T>,D> \
+funcname (const DualNumber<NumberEnsemble<W,T>,D>& a, DualNumber<NumberEnsemble<W,T>,D>&& b) \
+{ \
+  return std::funcname(a, static_cast<const DualNumber<NumberEnsemble<W,T>,D>&>(b)); \
+} \
+ \
+template <std::size_t W, typename T, typename D> \
+inline \
+DualNumber<NumberEnsemble<W,T>,D> \
+funcname (DualNumber<NumberEnsemble<W,T>,D>&& a, DualNumber<NumberEnsemble<W,T>,D>&& b) \
+{ \
+  return std::funcname(static_cast<const DualNumber<NumberEnsemble<W,T>,D>&>(a), \
+                       static_cast<const DualNumber<NumberEnsemble<W,T>,D>&>(b)); \
+} \
+ \
+template <std::size_t W, typename T, typename T2, typename D> \
+inline \
+typename MetaPhysicL::boostcopy::enable_if<MetaPhysicL::BuiltinTraits<T>, \
+  typename CompareTypes<DualNumber<NumberEnsemble<W,T2>,D>,T,true>::supertype>::type \
+funcname (const T& a, DualNumber<NumberEnsemble<W,T2>,D>&& b) \
+{ \
+  return std::funcname(a, static_cast<const DualNumber<NumberEnsemble<W,T2>,D>&>(b)); \
+}
+
+#define DualNumberEnsemble_std_binary_select(funcname, first, second) \
+template <std::size_t W, typename T, typename D> \
+inline \
+DualNumber<NumberEnsemble<W,T>,D> \
+funcname (const DualNumber<NumberEnsemble<W,T>,D>& a, const DualNumber<NumberEnsemble<W,T>,D>& b) \
+{ \
+  return MetaPhysicL::if_else(a.value() > b.value(), first, second); \
+} \
+ \
+DualNumberEnsemble_std_binary_moves(funcname) \
+ \
+template <std::size_t W, typename T, typename T2, typename D> \
+inline \
+typename MetaPhysicL::boostcopy::enable_if<MetaPhysicL::BuiltinTraits<T2>, \
+  typename CompareTypes<DualNumber<NumberEnsemble<W,T>,D>,T2>::supertype>::type \
+funcname (DualNumber<NumberEnsemble<W,T>,D>&& a, const T2& b) \
+{ \
+  return std::funcname(static_cast<const DualNumber<NumberEnsemble<W,T>,D>&>(a), b); \
+}
+
+DualNumberEnsemble_std_binary_select(max, a, b)
+DualNumberEnsemble_std_binary_select(min, b, a)
+
+
+// Value and both derivative coefficients in one pass; as in the
+// generic version, lanes where b' vanishes get no log(a) term, which
+// would be NaN for a <= 0.
+template <std::size_t W, typename T, typename D>
+inline
+DualNumber<NumberEnsemble<W,T>,D>
+pow (const DualNumber<NumberEnsemble<W,T>,D>& a, const DualNumber<NumberEnsemble<W,T>,D>& b)
+{
+  NumberEnsemble<W,T> funcval, dfda, dfdb;
+  const bool derivs = MetaPhysicL::dual_derivatives_enabled();
+  MetaPhysicL::SIMDMath::pow(W, &a.value()[0], &b.value()[0], &funcval[0],
+                             derivs ? &dfda[0] : NULL, derivs ? &dfdb[0] : NULL);
+  if (!derivs)
+    return DualNumber<NumberEnsemble<W,T>,D>(funcval);
+
+  DualNumber<NumberEnsemble<W,T>,D> returnval(funcval, a.derivatives());
+  D & d = returnval.derivatives();
+  const D & db = b.derivatives();
+  d *= dfda;
+  for (std::size_t i=0; i != d.size(); ++i)
+    d[i] += MetaPhysicL::if_else(db[i] != 0, db[i] * dfdb, 0);
+  return returnval;
+}
+
+DualNumberEnsemble_std_binary_moves(pow)
+
+
+// With METAPHYSICL_SIMD_MATH, ensembles of floating point values get
+// their function values and derivative factors from a single pass of
+// the vectorized kernels
+#ifdef METAPHYSICL_SIMD_MATH
+
+#define DualNumberEnsemble_simd_unary_T(funcname, T) \
+template <std::size_t W, typename D> \
+inline \
+DualNumber<NumberEnsemble<W, T>, D> \
+funcname (DualNumber<NumberEnsemble<W, T>, D> in) \
+{ \
+  if (!MetaPhysicL::dual_derivatives_enabled()) \
+    { \
+      MetaPhysicL::SIMDMath::funcname(W, &in.value()[0], &in.value()[0]); \
+      return in; \
+    } \
+  NumberEnsemble<W, T> factor; \
+  MetaPhysicL::SIMDMath::funcname(W, &in.value()[0], &in.value()[0], &factor[0]); \
+  in.derivatives() *= factor; \
+  return in; \
+}
+
+#define DualNumberEnsemble_simd_unary(funcname) \
+DualNumberEnsemble_simd_unary_T(funcname, double) \
+DualNumberEnsemble_simd_unary_T(funcname, float)
+
+DualNumberEnsemble_simd_unary(exp)
+DualNumberEnsemble_simd_unary(log)
+DualNumberEnsemble_simd_unary(sin)
+DualNumberEnsemble_simd_unary(cos)
+DualNumberEnsemble_simd_unary(tanh)
+DualNumberEnsemble_simd_unary(sqrt)
+
+#if __cplusplus >= 201103L
+DualNumberEnsemble_simd_unary(erf)
+#endif // __cplusplus >= 201103L
+#endif // METAPHYSICL_SIMD_MATH
+
+} // namespace std
+
+#endif // METAPHYSICL_DUALNUMBERENSEMBLE_H
@@ -0,0 +1,175 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// MetaPhysicL - A metaprogramming library for physics calculations
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+//
+// $Id$
+//
+//--------------------------------------------------------------------------
+
+
+#ifndef METAPHYSICL_DUALNUMBERENSEMBLE_DECL_H
+#define METAPHYSICL_DUALNUMBERENSEMBLE_DECL_H
+
+
+// The NumberEnsemble overloads of std functions, and the DualNumber
+// ensemble overloads declared here, have to be declared before the
+// DualNumber functions which call them
+#include "metaphysicl/numberensemble.h"
+#include "metaphysicl/numberarray.h"
+#include "metaphysicl/dualnumber_decl.h"
+
+
+namespace MetaPhysicL {
+
+// DualNumber<NumberEnsemble<W,T>, NumberArray<N, NumberEnsemble<W,T> > >
+// evaluates a DualNumber<T, NumberArray<N,T> > at W points at once:
+// one value and N derivatives per lane.
+
+template <std::size_t W, std::size_t N, typename T>
+struct EnsembleType<W, NumberArray<N, T> >
+{
+  typedef NumberArray<N, typename EnsembleType<W, T>::type> type;
+};
+
+template <std::size_t W, typename T, typename D>
+struct EnsembleType<W, DualNumber<T, D> >
+{
+  typedef DualNumber<typename EnsembleType<W, T>::type,
+                     typename EnsembleType<W, D>::type> type;
+};
+
+template <std::size_t N, typename T>
+struct EnsembleSize<NumberArray<N, T> >
+{
+  static const std::size_t value = EnsembleSize<T>::value;
+};
+
+template <typename T, typename D>
+struct EnsembleSize<DualNumber<T, D> >
+{
+  static const std::size_t value = EnsembleSize<T>::value;
+};
+
+
+// NumberEnsemble is subordinate to DualNumber, as builtins are
+
+#define DualNumberEnsemble_comparisons(templatename) \
+template<typename T, typename D, std::size_t W, typename T2, bool reverseorder> \
+struct templatename<DualNumber<T, D>, NumberEnsemble<W, T2>, reverseorder> { \
+  typedef DualNumber<typename Symmetric##templatename<T, NumberEnsemble<W, T2>, reverseorder>::supertype, \
+                     typename Symmetric##templatename<D, NumberEnsemble<W, T2>, reverseorder>::supertype> \
+    supertype; \
+}; \
+ \
+template<typename T, typename D, std::size_t W, typename T2, bool reverseorder> \
+struct templatename<NumberEnsemble<W, T2>, DualNumber<T, D>, reverseorder> { \
+  typedef typename templatename<DualNumber<T, D>, NumberEnsemble<W, T2>, !reverseorder>::supertype \
+    supertype; \
+}
+
+DualNumberEnsemble_comparisons(CompareTypes);
+DualNumberEnsemble_comparisons(PlusType);
+DualNumberEnsemble_comparisons(MinusType);
+DualNumberEnsemble_comparisons(MultipliesType);
+DualNumberEnsemble_comparisons(DividesType);
+
+} // namespace MetaPhysicL
+
+
+namespace std {
+
+using MetaPhysicL::DualNumber;
+using MetaPhysicL::NumberEnsemble;
+
+// The generic DualNumber versions of these branch on their values, so
+// ensembles get their own, including versions for temporaries
+
+#define DualNumberEnsemble_decl_std_binary_moves(funcname) \
+template <std::size_t W, typename T, typename D> \
+inline \
+DualNumber<NumberEnsemble<W,T>,D> \
+funcname (DualNumber<NumberEnsemble<W,T>,D>&& a, const DualNumber<NumberEnsemble<W,T>,D>& b); \
+ \
+template <std::size_t W, typename T, typename D> \
+inline \
+DualNumber<NumberEnsemble<W,T>,D> \
+funcname (const DualNumber<NumberEnsemble<W,T>,D>& a, DualNumber<NumberEnsemble<W,T>,D>&& b); \
+ \
+template <std::size_t W, typename T, typename D> \
+inline \
+DualNumber<NumberEnsemble<W,T>,D> \
+funcname (DualNumber<NumberEnsemble<W,T>,D>&& a, DualNumber<NumberEnsemble<W,T>,D>&& b); \
+ \
+template <std::size_t W, typename T, typename T2, typename D> \
+inline \
+typename MetaPhysicL::boostcopy::enable_if<MetaPhysicL::BuiltinTraits<T>, \
+  typename CompareTypes<DualNumber<NumberEnsemble<W,T2>,D>,T,true>::supertype>::type \
+funcname (const T& a, DualNumber<NumberEnsemble<W,T2>,D>&& b)
+
+#define DualNumberEnsemble_decl_std_binary(funcname) \
+template <std::size_t W, typename T, typename D> \
+inline \
+DualNumber<NumberEnsemble<W,T>,D> \
+funcname (const DualNumber<NumberEnsemble<W,T>,D>& a, const DualNumber<NumberEnsemble<W,T>,D>& b); \
+ \
+DualNumberEnsemble_decl_std_binary_moves(funcname)
+
+#define DualNumberEnsemble_decl_std_binary_select(funcname) \
+DualNumberEnsemble_decl_std_binary(funcname); \
+ \
+template <std::size_t W, typename T, typename T2, typename D> \
+inline \
+typename MetaPhysicL::boostcopy::enable_if<MetaPhysicL::BuiltinTraits<T2>, \
+  typename CompareTypes<DualNumber<NumberEnsemble<W,T>,D>,T2>::supertype>::type \
+funcname (DualNumber<NumberEnsemble<W,T>,D>&& a, const T2& b)
+
+DualNumberEnsemble_decl_std_binary(pow);
+DualNumberEnsemble_decl_std_binary_select(max);
+DualNumberEnsemble_decl_std_binary_select(min);
+
+#ifdef METAPHYSICL_SIMD_MATH
+#define DualNumberEnsemble_decl_simd_unary_T(funcname, T) \
+template <std::size_t W, typename D> \
+inline \
+DualNumber<NumberEnsemble<W, T>, D> \
+funcname (DualNumber<NumberEnsemble<W, T>, D> in)
+
+#define DualNumberEnsemble_decl_simd_unary(funcname) \
+DualNumberEnsemble_decl_simd_unary_T(funcname, double); \
+DualNumberEnsemble_decl_simd_unary_T(funcname, float)
+
+DualNumberEnsemble_decl_simd_unary(exp);
+DualNumberEnsemble_decl_simd_unary(log);
+DualNumberEnsemble_decl_simd_unary(sin);
+DualNumberEnsemble_decl_simd_unary(cos);
+DualNumberEnsemble_decl_simd_unary(tanh);
+DualNumberEnsemble_decl_simd_unary(sqrt);
+
+#if __cplusplus >= 201103L
+DualNumberEnsemble_decl_simd_unary(erf);
+#endif // __cplusplus >= 201103L
+#endif // METAPHYSICL_SIMD_MATH
+
+} // namespace std
+
+
+#endif // METAPHYSICL_DUALNUMBERENSEMBLE_DECL_H
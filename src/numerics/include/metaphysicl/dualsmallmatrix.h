@@ -0,0 +1,233 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// MetaPhysicL - A metaprogramming library for physics calculations
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+//
+// $Id$
+//
+//--------------------------------------------------------------------------
+
+#ifndef METAPHYSICL_DUALSMALLMATRIX_H
+#define METAPHYSICL_DUALSMALLMATRIX_H
+
+#include "metaphysicl/dualnumber.h"
+#include "metaphysicl/smallmatrix.h"
+
+namespace MetaPhysicL {
+
+// Small matrix operations on DualNumber entries, which do the
+// decomposition on values alone and then apply the derivative of the
+// operation as a whole:
+//
+//   d(det A)   = tr(adj(A) dA)
+//   d(A^-1)    = -A^-1 dA A^-1
+//   d(A^-1 b)  = A^-1 (db - dA x)
+//   d(lambda_i) = v_i^T dA v_i, for distinct eigenvalues of symmetric A
+//
+// matmul needs no overload; the product rule on its scalar operations
+// is already the cheapest form.
+//
+// With derivatives switched off (see dualvaluesonly.h) each returns
+// after the decomposition.
+
+template <std::size_t N, typename T, typename D>
+inline
+NumberVector<N, NumberVector<N, T> >
+dual_matrix_values(const NumberVector<N, NumberVector<N, DualNumber<T,D> > >& a)
+{
+  NumberVector<N, NumberVector<N, T> > returnval;
+  Unroll<N>::apply([&](std::size_t i){
+    Unroll<N>::apply([&](std::size_t j){ returnval[i][j] = a[i][j].value(); });
+  });
+  return returnval;
+}
+
+
+// Returns sum_ij coefs[i][j] * a[i][j].derivatives()
+template <std::size_t N, typename T, typename D>
+inline
+D
+dual_matrix_contract(const NumberVector<N, NumberVector<N, T> >& coefs,
+                     const NumberVector<N, NumberVector<N, DualNumber<T,D> > >& a)
+{
+  D returnval = coefs[0][0] * a[0][0].derivatives();
+  for (std::size_t i=0; i != N; ++i)
+    for (std::size_t j=(i==0); j != N; ++j)
+      dual_product_update(returnval, coefs[i][j], a[i][j].derivatives(), T(1));
+  return returnval;
+}
+
+
+template <std::size_t N, typename T, typename D>
+inline
+DualNumber<T,D>
+determinant(const NumberVector<N, NumberVector<N, DualNumber<T,D> > >& a)
+{
+  const NumberVector<N, NumberVector<N, T> > values = dual_matrix_values(a);
+  if (!dual_derivatives_enabled())
+    return DualNumber<T,D>(determinant(values));
+
+  const NumberVector<N, NumberVector<N, T> > adj = adjugate(values);
+
+  return DualNumber<T,D>(determinant(values),
+                         dual_matrix_contract(transpose(adj), a));
+}
+
+
+template <std::size_t N, typename T, typename D>
+inline
+NumberVector<N, NumberVector<N, DualNumber<T,D> > >
+inverse(const NumberVector<N, NumberVector<N, DualNumber<T,D> > >& a)
+{
+  const NumberVector<N, NumberVector<N, T> > inv =
+    inverse(dual_matrix_values(a));
+  if (!dual_derivatives_enabled())
+    return NumberVector<N, NumberVector<N, DualNumber<T,D> > >(inv);
+
+  // dA A^-1 first, then -A^-1 times that
+  NumberVector<N, NumberVector<N, D> > da_inv;
+  for (std::size_t k=0; k != N; ++k)
+    for (std::size_t j=0; j != N; ++j)
+      {
+        da_inv[k][j] = inv[0][j] * a[k][0].derivatives();
+        for (std::size_t l=1; l != N; ++l)
+          dual_product_update(da_inv[k][j], inv[l][j], a[k][l].derivatives(), T(1));
+      }
+
+  NumberVector<N, NumberVector<N, DualNumber<T,D> > > returnval;
+  for (std::size_t i=0; i != N; ++i)
+    for (std::size_t j=0; j != N; ++j)
+      {
+        D d = -inv[i][0] * da_inv[0][j];
+        for (std::size_t k=1; k != N; ++k)
+          dual_product_update(d, -inv[i][k], da_inv[k][j], T(1));
+        returnval[i][j] = DualNumber<T,D>(inv[i][j], d);
+      }
+
+  return returnval;
+}
+
+
+// With a constant right hand side
+template <std::size_t N, typename T, typename D, typename T2>
+inline
+NumberVector<N, DualNumber<T,D> >
+solve(const NumberVector<N, NumberVector<N, DualNumber<T,D> > >& a,
+      const NumberVector<N, T2>& b)
+{
+  const NumberVector<N, NumberVector<N, T> > inv =
+    inverse(dual_matrix_values(a));
+  const NumberVector<N, T> x = matmul(inv, NumberVector<N, T>(b));
+  if (!dual_derivatives_enabled())
+    return NumberVector<N, DualNumber<T,D> >(x);
+
+  // The residual derivative -dA x
+  NumberVector<N, D> dr;
+  for (std::size_t k=0; k != N; ++k)
+    {
+      dr[k] = -x[0] * a[k][0].derivatives();
+      for (std::size_t l=1; l != N; ++l)
+        dual_product_update(dr[k], -x[l], a[k][l].derivatives(), T(1));
+    }
+
+  NumberVector<N, DualNumber<T,D> > returnval;
+  for (std::size_t i=0; i != N; ++i)
+    {
+      D d = inv[i][0] * dr[0];
+      for (std::size_t k=1; k != N; ++k)
+        dual_product_update(d, inv[i][k], dr[k], T(1));
+      returnval[i] = DualNumber<T,D>(x[i], d);
+    }
+
+  return returnval;
+}
+
+
+template <std::size_t N, typename T, typename D>
+inline
+NumberVector<N, DualNumber<T,D> >
+solve(const NumberVector<N, NumberVector<N, DualNumber<T,D> > >& a,
+      const NumberVector<N, DualNumber<T,D> >& b)
+{
+  const NumberVector<N, NumberVector<N, T> > inv =
+    inverse(dual_matrix_values(a));
+
+  NumberVector<N, T> b_values;
+  for (std::size_t k=0; k != N; ++k)
+    b_values[k] = b[k].value();
+  const NumberVector<N, T> x = matmul(inv, b_values);
+  if (!dual_derivatives_enabled())
+    return NumberVector<N, DualNumber<T,D> >(x);
+
+  // The residual derivative db - dA x
+  NumberVector<N, D> dr;
+  for (std::size_t k=0; k != N; ++k)
+    {
+      dr[k] = b[k].derivatives();
+      for (std::size_t l=0; l != N; ++l)
+        dual_product_update(dr[k], -x[l], a[k][l].derivatives(), T(1));
+    }
+
+  NumberVector<N, DualNumber<T,D> > returnval;
+  for (std::size_t i=0; i != N; ++i)
+    {
+      D d = inv[i][0] * dr[0];
+      for (std::size_t k=1; k != N; ++k)
+        dual_product_update(d, inv[i][k], dr[k], T(1));
+      returnval[i] = DualNumber<T,D>(x[i], d);
+    }
+
+  return returnval;
+}
+
+
+// Derivatives are taken from the upper triangle of a, like the
+// eigenvalues themselves
+template <std::size_t N, typename T, typename D>
+inline
+NumberVector<N, DualNumber<T,D> >
+symmetric_eigenvalues(const NumberVector<N, NumberVector<N, DualNumber<T,D> > >& a)
+{
+  NumberVector<N, NumberVector<N, DualNumber<T,D> > > upper = a;
+  for (std::size_t i=0; i != N; ++i)
+    for (std::size_t j=0; j != i; ++j)
+      upper[i][j] = a[j][i];
+
+  NumberVector<N, T> eigenvalues;
+  NumberVector<N, NumberVector<N, T> > eigenvectors;
+  if (!dual_derivatives_enabled())
+    return NumberVector<N, DualNumber<T,D> >
+      (symmetric_eigenvalues(dual_matrix_values(upper)));
+
+  symmetric_eigensystem(dual_matrix_values(upper), eigenvalues, eigenvectors);
+
+  NumberVector<N, DualNumber<T,D> > returnval;
+  for (std::size_t i=0; i != N; ++i)
+    returnval[i] = DualNumber<T,D>
+      (eigenvalues[i],
+       dual_matrix_contract(eigenvectors[i].outerproduct(eigenvectors[i]), upper));
+
+  return returnval;
+}
+
+} // namespace MetaPhysicL
+
+#endif // METAPHYSICL_DUALSMALLMATRIX_H
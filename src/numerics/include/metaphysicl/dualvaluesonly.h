@@ -0,0 +1,98 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// MetaPhysicL - A metaprogramming library for physics calculations
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+//
+// $Id$
+//
+//--------------------------------------------------------------------------
+
+#ifndef METAPHYSICL_DUALVALUESONLY_H
+#define METAPHYSICL_DUALVALUESONLY_H
+
+namespace MetaPhysicL {
+
+// A switch for evaluating code templated on DualNumber for its values
+// alone, e.g. the residuals of a line search.  While a scope is active
+// on a thread, DualNumber arithmetic and std functions compute values
+// and skip all derivative propagation; the derivatives of their
+// results are unspecified until the scope is destroyed and they are
+// recomputed.
+//
+//   {
+//     DualNumberValuesOnly values_only;
+//     compute_residual(x + alpha * dx, r);
+//   }
+//
+// Scopes nest, and one constructed with a false argument turns
+// derivatives back on within another.  Constructing a scope is a
+// couple of loads and stores, cheap enough to toggle per iteration.
+// In C++11 each thread has its own switch; in C++98 there is one.
+//
+// The switch can be fixed at compile time instead, by defining one of
+// the following consistently in every translation unit of a program:
+//
+//   METAPHYSICL_DUAL_VALUES_ONLY      - derivatives are never computed
+//   METAPHYSICL_NO_DUAL_VALUES_ONLY   - derivatives are always computed,
+//                                       without checking the switch
+
+class DualNumberValuesOnly
+{
+public:
+  DualNumberValuesOnly(bool values_only = true) : _previous(active_ref())
+    { active_ref() = values_only; }
+
+  ~DualNumberValuesOnly() { active_ref() = _previous; }
+
+  // Whether values only are being computed on this thread
+  static bool active() { return active_ref(); }
+
+private:
+  static bool& active_ref()
+  {
+#if __cplusplus >= 201103L
+    static thread_local bool values_only = false;
+#else
+    static bool values_only = false;
+#endif
+    return values_only;
+  }
+
+  bool _previous;
+};
+
+
+// Whether DualNumber operations should propagate derivatives
+inline
+bool dual_derivatives_enabled()
+{
+#if defined(METAPHYSICL_DUAL_VALUES_ONLY)
+  return false;
+#elif defined(METAPHYSICL_NO_DUAL_VALUES_ONLY)
+  return true;
+#else
+  return !DualNumberValuesOnly::active();
+#endif
+}
+
+} // namespace MetaPhysicL
+
+#endif // METAPHYSICL_DUALVALUESONLY_H
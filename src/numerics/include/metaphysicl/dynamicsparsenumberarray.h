@@ -151,6 +151,8 @@ DynamicSparseNumberBase_op(DynamicSparseNumberArray, -, Minus)      // Union)
 DynamicSparseNumberBase_op(DynamicSparseNumberArray, *, Multiplies) // Intersection)
 DynamicSparseNumberBase_op(DynamicSparseNumberArray, /, Divides)    // First)
 
+DynamicSparseNumberBase_dual_updates(DynamicSparseNumberArray)
+
 
 template <typename T, typename I>
 inline
@@ -170,4 +172,11 @@ RawType<DynamicSparseNumberArray<T, I> >::value(const DynamicSparseNumberArray<T
 
 } // namespace MetaPhysicL
 
+
+namespace std {
+
+DynamicSparseNumberBase_std_minmax(DynamicSparseNumberArray)
+
+} // namespace std
+
 #endif // METAPHYSICL_DYNAMICSPARSENUMBERARRAY_H
@@ -202,6 +202,8 @@ DynamicSparseNumberBase_decl_op(DynamicSparseNumberArray, -, Minus)      // Unio
 DynamicSparseNumberBase_decl_op(DynamicSparseNumberArray, *, Multiplies) // Intersection)
 DynamicSparseNumberBase_decl_op(DynamicSparseNumberArray, /, Divides)    // First)
 
+DynamicSparseNumberBase_decl_dual_updates(DynamicSparseNumberArray)
+
 
 // CompareTypes, RawType, ValueType specializations
 
@@ -239,6 +241,8 @@ template <typename T, typename I>
 class numeric_limits<DynamicSparseNumberArray<T, I> > :
   public MetaPhysicL::raw_numeric_limits<DynamicSparseNumberArray<T, I>, T> {};
 
+DynamicSparseNumberBase_decl_std_minmax(DynamicSparseNumberArray)
+
 } // namespace std
 
 
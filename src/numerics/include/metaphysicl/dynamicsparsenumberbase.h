@@ -30,6 +30,7 @@
 #define METAPHYSICL_DYNAMICSPARSENUMBERBASE_H
 
 #include "metaphysicl/dynamicsparsenumberbase_decl.h"
+#include "metaphysicl/integerpow.h"
 
 namespace MetaPhysicL {
 
@@ -56,9 +57,9 @@ template <typename T, typename I, template <typename, typename> class SubType>
 template <typename T2, typename I2>
 inline
 DynamicSparseNumberBase<T,I,SubType>::DynamicSparseNumberBase(const DynamicSparseNumberBase<T2, I2, SubType> & src)
-{ this->resize(src.size());
+{ _data.resize(src.size());
   std::copy(src.nude_data().begin(), src.nude_data().end(), _data.begin());
-  std::copy(src.nude_indices().begin(), src.nude_indices().end(), _indices.begin()); }
+  copy_sparsity(_indices, src.nude_indices()); }
 
 template <typename T, typename I, template <typename, typename> class SubType>
 inline
@@ -110,13 +111,13 @@ DynamicSparseNumberBase<T,I,SubType>::nude_data()
 
 template <typename T, typename I, template <typename, typename> class SubType>
 inline
-const std::vector<I>&
+const typename SparsityStorage<I>::type&
 DynamicSparseNumberBase<T,I,SubType>::nude_indices() const
 { return _indices; }
 
 template <typename T, typename I, template <typename, typename> class SubType>
 inline
-std::vector<I>&
+typename SparsityStorage<I>::type&
 DynamicSparseNumberBase<T,I,SubType>::nude_indices()
 { return _indices; }
 
@@ -125,7 +126,7 @@ inline
 std::size_t
 DynamicSparseNumberBase<T,I,SubType>::runtime_index_query(index_value_type i) const
 {
-  typename std::vector<I>::const_iterator it =
+  typename SparsityStorage<I>::type::const_iterator it =
     std::lower_bound(_indices.begin(), _indices.end(), i);
   if (it == _indices.end() || *it != i)
     return std::numeric_limits<std::size_t>::max();
@@ -139,7 +140,7 @@ inline
 std::size_t
 DynamicSparseNumberBase<T,I,SubType>::runtime_index_of(index_value_type i) const
 {
-  typename std::vector<I>::const_iterator it =
+  typename SparsityStorage<I>::type::const_iterator it =
     std::lower_bound(_indices.begin(), _indices.end(), i);
   metaphysicl_assert(it != _indices.end());
   std::size_t offset = it - _indices.begin();
@@ -197,12 +198,14 @@ inline
 typename DynamicSparseNumberBase<T,I,SubType>::value_type&
 DynamicSparseNumberBase<T,I,SubType>::insert(unsigned int i)
 {
-  typename std::vector<I>::const_iterator upper_it =
-    std::lower_bound(_indices.begin(), _indices.end(), i);
-  std::size_t offset = upper_it - _indices.begin();
+  // Look i up without unsharing a shared pattern
+  const typename SparsityStorage<I>::type& indices = _indices;
+  typename SparsityStorage<I>::type::const_iterator upper_it =
+    std::lower_bound(indices.begin(), indices.end(), i);
+  std::size_t offset = upper_it - indices.begin();
 
   // If we don't have entry i, insert it.  Yes this is O(N).
-  if ((upper_it == _indices.end()) ||
+  if ((upper_it == indices.end()) ||
       *upper_it != i)
     {
       std::size_t old_size = this->size();
@@ -233,6 +236,106 @@ DynamicSparseNumberBase<T,I,SubType>::set(const T2& val) {
   _data[runtime_index_of(i)] = val;
 }
 
+template <typename T, typename I, template <typename, typename> class SubType>
+template <typename I2, typename T2>
+inline
+void
+DynamicSparseNumberBase<T,I,SubType>::insert(const I2* indices,
+                                             const T2* values,
+                                             std::size_t n)
+{
+  const std::size_t old_size = this->size();
+  this->reserve(old_size + n);
+  for (std::size_t k = 0; k != n; ++k)
+    this->append(indices[k], values[k]);
+  this->sort_tail(old_size);
+  this->sparsity_adapt();
+}
+
+template <typename T, typename I, template <typename, typename> class SubType>
+inline
+void
+DynamicSparseNumberBase<T,I,SubType>::reserve(std::size_t n)
+{
+  _data.reserve(n);
+  _indices.reserve(n);
+}
+
+template <typename T, typename I, template <typename, typename> class SubType>
+template <typename T2>
+inline
+void
+DynamicSparseNumberBase<T,I,SubType>::append(index_value_type i,
+                                             const T2& val)
+{
+  _indices.push_back(i);
+  _data.push_back(val);
+}
+
+template <typename T, typename I, template <typename, typename> class SubType>
+inline
+void
+DynamicSparseNumberBase<T,I,SubType>::finalize()
+{
+  // Whatever is already in order can stay put
+  const typename SparsityStorage<I>::type& indices = _indices;
+  std::size_t first_unsorted = 1;
+  const std::size_t index_size = this->size();
+  while (first_unsorted < index_size &&
+         indices[first_unsorted-1] < indices[first_unsorted])
+    ++first_unsorted;
+
+  if (first_unsorted < index_size)
+    this->sort_tail(first_unsorted);
+
+  this->sparsity_adapt();
+}
+
+template <typename T, typename I, template <typename, typename> class SubType>
+inline
+void
+DynamicSparseNumberBase<T,I,SubType>::sort_tail(std::size_t first_unsorted)
+{
+  const std::size_t index_size = this->size();
+  if (first_unsorted == index_size)
+    return;
+
+  const typename SparsityStorage<I>::type& indices = _indices;
+  std::vector<std::size_t> perm;
+  SortedPermutation<I>::build(&indices[first_unsorted],
+                              index_size - first_unsorted, perm);
+
+  std::vector<T> merged_data;
+  typename SparsityStorage<I>::type merged_indices;
+  merged_data.reserve(index_size);
+  merged_indices.reserve(index_size);
+
+  // Old entries go first on ties, so repeated indices are summed in
+  // the same order one-at-a-time insertion would have used
+  std::size_t i = 0, k = 0;
+  while (i != first_unsorted || k != perm.size())
+    {
+      std::size_t from;
+      if (k == perm.size() ||
+          (i != first_unsorted &&
+           !(indices[first_unsorted + perm[k]] < indices[i])))
+        from = i++;
+      else
+        from = first_unsorted + perm[k++];
+
+      if (!merged_indices.empty() && merged_indices.back() == indices[from])
+        merged_data.back() += _data[from];
+      else
+        {
+          merged_indices.push_back(indices[from]);
+          merged_data.push_back(_data[from]);
+        }
+    }
+
+  _data.swap(merged_data);
+  _indices.swap(merged_indices);
+}
+
 template <typename T, typename I, template <typename, typename> class SubType>
 inline
 bool
@@ -262,78 +365,50 @@ DynamicSparseNumberBase<T,I,SubType>::operator- () const {
   // Since this is a dynamically allocated sparsity pattern, we can
   // increase it as needed to support e.g. operator+=
 template <typename T, typename I, template <typename, typename> class SubType>
-template <typename I2>
+template <typename Indices2>
 inline
 void
-DynamicSparseNumberBase<T,I,SubType>::sparsity_union (const std::vector<I2>& new_indices)
+DynamicSparseNumberBase<T,I,SubType>::sparsity_union (const Indices2& new_indices)
 {
+  const typename SparsityStorage<I>::type& old_indices = _indices;
+
   metaphysicl_assert
-    (std::adjacent_find(_indices.begin(), _indices.end()) ==
-     _indices.end());
+    (std::adjacent_find(old_indices.begin(), old_indices.end()) ==
+     old_indices.end());
   metaphysicl_assert
     (std::adjacent_find(new_indices.begin(), new_indices.end()) ==
      new_indices.end());
 #ifdef METAPHYSICL_HAVE_CXX11
-  metaphysicl_assert(std::is_sorted(_indices.begin(), _indices.end()));
+  metaphysicl_assert(std::is_sorted(old_indices.begin(), old_indices.end()));
   metaphysicl_assert(std::is_sorted(new_indices.begin(), new_indices.end()));
 #endif
 
-  typename std::vector<I>::iterator index_it = _indices.begin();
-  typename std::vector<I2>::const_iterator index2_it = new_indices.begin();
-
-  typedef typename CompareTypes<I,I2>::supertype max_index_type;
-  max_index_type unseen_indices = 0;
-
-  const I maxI = std::numeric_limits<I>::max();
-
-  while (index2_it != new_indices.end()) {
-    I idx1 = (index_it == _indices.end()) ? maxI : *index_it;
-    I2 idx2 = *index2_it;
-
-    while (idx1 < idx2) {
-      ++index_it;
-      idx1 = (index_it == _indices.end()) ? maxI : *index_it;
-    }
-
-    while ((idx1 == idx2) &&
-           (idx1 != maxI)) {
-      ++index_it;
-      idx1 = (index_it == _indices.end()) ? maxI : *index_it;
-      ++index2_it;
-      idx2 = (index2_it == new_indices.end()) ? maxI : *index2_it;
-    }
+  std::size_t old_size = this->size();
 
-    while (idx2 < idx1) {
-      ++unseen_indices;
-        ++index2_it;
-      if (index2_it == new_indices.end())
-        break;
-      idx2 = *index2_it;
-    }
-  }
+  const std::size_t unseen_indices = new_indices.size() -
+    SortedSet::intersection_size(old_indices.begin(), old_indices.end(),
+                                 new_indices.begin(), new_indices.end());
 
   // The common case is cheap
   if (!unseen_indices)
     return;
 
-  std::size_t old_size = this->size();
-
   this->resize(old_size + unseen_indices);
 
   typename std::vector<T>::reverse_iterator md_it = _data.rbegin();
-  typename std::vector<I>::reverse_iterator mi_it = _indices.rbegin();
+  typename SparsityStorage<I>::type::reverse_iterator mi_it = _indices.rbegin();
 
   typename std::vector<T>::const_reverse_iterator d_it =
     _data.rbegin() + unseen_indices;
-  typename std::vector<I>::const_reverse_iterator i_it =
+  typename SparsityStorage<I>::type::const_reverse_iterator i_it =
     _indices.rbegin() + unseen_indices;
-  typename std::vector<I2>::const_reverse_iterator i2_it = new_indices.rbegin();
+  typename Indices2::const_reverse_iterator i2_it = new_indices.rbegin();
 
   // Duplicate copies of rend() to work around
   // http://www.open-std.org/jtc1/sc22/wg21/docs/lwg-defects.html#179
-  typename std::vector<I>::reverse_iterator      mirend  = _indices.rend();
-  typename std::vector<I>::const_reverse_iterator  rend  = mirend;
-  typename std::vector<I2>::const_reverse_iterator rend2 = new_indices.rend();
+  typename SparsityStorage<I>::type::reverse_iterator      mirend  = _indices.rend();
+  typename SparsityStorage<I>::type::const_reverse_iterator  rend  = mirend;
+  typename Indices2::const_reverse_iterator rend2 = new_indices.rend();
 #ifndef NDEBUG
   typename std::vector<T>::reverse_iterator      mdrend = _data.rend();
   typename std::vector<T>::const_reverse_iterator drend = mdrend;
@@ -369,44 +444,47 @@ DynamicSparseNumberBase<T,I,SubType>::sparsity_union (const std::vector<I2>& new
   // Since this is a dynamically allocated sparsity pattern, we can
   // decrease it when possible for efficiency
 template <typename T, typename I, template <typename, typename> class SubType>
-template <typename I2>
+template <typename Indices2>
 inline
 void
-DynamicSparseNumberBase<T,I,SubType>::sparsity_intersection (const std::vector<I2>& new_indices)
+DynamicSparseNumberBase<T,I,SubType>::sparsity_intersection (const Indices2& new_indices)
 {
+  const typename SparsityStorage<I>::type& indices = _indices;
+
   metaphysicl_assert
-    (std::adjacent_find(_indices.begin(), _indices.end()) ==
-     _indices.end());
+    (std::adjacent_find(indices.begin(), indices.end()) ==
+     indices.end());
   metaphysicl_assert
     (std::adjacent_find(new_indices.begin(), new_indices.end()) ==
      new_indices.end());
 #ifdef METAPHYSICL_HAVE_CXX11
-  metaphysicl_assert(std::is_sorted(_indices.begin(), _indices.end()));
+  metaphysicl_assert(std::is_sorted(indices.begin(), indices.end()));
   metaphysicl_assert(std::is_sorted(new_indices.begin(), new_indices.end()));
 #endif
 
 #ifndef NDEBUG
+  typedef typename Indices2::value_type I2;
   typedef typename CompareTypes<I,I2>::supertype max_index_type;
-  typename std::vector<I>::iterator index_it = _indices.begin();
-  typename std::vector<I2>::const_iterator index2_it = new_indices.begin();
+  typename SparsityStorage<I>::type::const_iterator index_it = indices.begin();
+  typename Indices2::const_iterator index2_it = new_indices.begin();
 
   max_index_type shared_indices = 0;
 
   const I maxI = std::numeric_limits<I>::max();
 
   while (index2_it != new_indices.end()) {
-    I idx1 = (index_it == _indices.end()) ? maxI : *index_it;
+    I idx1 = (index_it == indices.end()) ? maxI : *index_it;
     I2 idx2 = *index2_it;
 
     while (idx1 < idx2) {
       ++index_it;
-      idx1 = (index_it == _indices.end()) ? maxI : *index_it;
+      idx1 = (index_it == indices.end()) ? maxI : *index_it;
     }
 
     while ((idx1 == idx2) &&
            (idx1 != maxI)) {
       ++index_it;
-      idx1 = (index_it == _indices.end()) ? maxI : *index_it;
+      idx1 = (index_it == indices.end()) ? maxI : *index_it;
       ++index2_it;
       idx2 = (index2_it == new_indices.end()) ? maxI : *index2_it;
       ++shared_indices;
@@ -421,75 +499,115 @@ DynamicSparseNumberBase<T,I,SubType>::sparsity_intersection (const std::vector<I
   }
 #endif
 
-  // We'll loop up through the arrays, copying indices (and
-  // corresponding data) that should be there downward into place.
+  const std::size_t n_indices =
+    SortedSet::intersect_in_place(_indices.begin(), _indices.end(),
+                                  new_indices.begin(), new_indices.end(),
+                                  _data.begin());
 
-  // Merged values:
-  typename std::vector<T>::iterator md_it = _data.begin();
-  typename std::vector<I>::iterator mi_it = _indices.begin();
+  metaphysicl_assert_equal_to(n_indices, shared_indices);
 
-  // Our old values:
-  typename std::vector<T>::const_iterator d_it = _data.begin();
-  typename std::vector<I>::const_iterator i_it = _indices.begin();
+  _indices.resize(n_indices);
+  _data.resize(n_indices);
+}
 
-  // Values to merge with:
-  typename std::vector<I2>::const_iterator i2_it = new_indices.begin();
+template <typename T, typename I, template <typename, typename> class SubType>
+inline
+void
+DynamicSparseNumberBase<T,I,SubType>::sparsity_densify ()
+{
+  const std::size_t old_size = this->size();
+  if (!old_size)
+    return;
 
-  for (; i_it != _indices.end() && i2_it != new_indices.end();
-       ++md_it, ++mi_it, ++d_it, ++i_it, ++i2_it) {
-    while (*i2_it < *i_it) {
-      ++i2_it;
-      if (i2_it == new_indices.end())
-        break;
-    }
-    if (i2_it == new_indices.end())
-      break;
-    while (*i2_it > *i_it) {
-        ++i_it;
-      if (i_it == _indices.end())
-        break;
-    }
-    if (i_it == _indices.end())
-      break;
+  const typename SparsityStorage<I>::type& indices = _indices;
+  const I front = indices[0];
+  const std::size_t span = std::size_t(indices[old_size-1] - front) + 1;
+  if (span == old_size)
+    return;
 
-    *md_it = *d_it;
-    *mi_it = *i_it;
-  }
+  this->resize(span);
 
-  metaphysicl_assert_equal_to(md_it - _data.begin(),
-                              shared_indices);
-  metaphysicl_assert_equal_to(mi_it - _indices.begin(),
-                              shared_indices);
+  // Spread our entries upward from the back, so none is overwritten
+  // before it has moved
+  std::size_t i = old_size;
+  for (std::size_t out = span; out--;)
+    {
+      if (i && std::size_t(_indices[i-1] - front) == out)
+        {
+          --i;
+          if (out != i)
+            {
+              using std::swap;
+              swap(_data[out], _data[i]);
+            }
+        }
+      else
+        _data[out] = 0;
+      _indices[out] = front + out;
+    }
 
-  const std::size_t n_indices = md_it - _data.begin();
+  metaphysicl_assert_equal_to(i, 0);
+}
 
-  _indices.resize(n_indices);
-  _data.resize(n_indices);
+template <typename T, typename I, template <typename, typename> class SubType>
+inline
+void
+DynamicSparseNumberBase<T,I,SubType>::sparsity_adapt ()
+{
+  const double threshold = DensifyThreshold<SubType<T,I> >::value();
+  if (threshold > 1)
+    return;
+
+  const typename SparsityStorage<I>::type& indices = _indices;
+  const std::size_t index_size = this->size();
+  if (index_size > 1 &&
+      index_size >= threshold *
+        (std::size_t(indices[index_size-1] - indices[0]) + 1))
+    this->sparsity_densify();
 }
 
 
 
   // Since this is a dynamically allocated sparsity pattern, we can
   // decrease it when possible for efficiency
+template <typename T, typename I, template <typename, typename> class SubType>
+inline
+void
+DynamicSparseNumberBase<T,I,SubType>::sparsity_intern ()
+{
+  intern_sparsity(_indices);
+}
+
 template <typename T, typename I, template <typename, typename> class SubType>
 inline
 void
 DynamicSparseNumberBase<T,I,SubType>::sparsity_trim ()
 {
+  const typename SparsityStorage<I>::type& indices = _indices;
+
   metaphysicl_assert
-    (std::adjacent_find(_indices.begin(), _indices.end()) ==
-     _indices.end());
+    (std::adjacent_find(indices.begin(), indices.end()) ==
+     indices.end());
 #ifdef METAPHYSICL_HAVE_CXX11
-  metaphysicl_assert(std::is_sorted(_indices.begin(), _indices.end()));
+  metaphysicl_assert(std::is_sorted(indices.begin(), indices.end()));
 #endif
 
+  // Leave a shared pattern shared if there is nothing to trim
+  {
+    typename std::vector<T>::const_iterator d_it = _data.begin();
+    while (d_it != _data.end() && *d_it)
+      ++d_it;
+    if (d_it == _data.end())
+      return;
+  }
+
 #ifndef NDEBUG
   I used_indices = 0;
 
   {
-    typename std::vector<I>::iterator index_it = _indices.begin();
+    typename SparsityStorage<I>::type::const_iterator index_it = indices.begin();
     typename std::vector<T>::iterator data_it = _data.begin();
-    for (; index_it != _indices.end(); ++index_it, ++data_it)
+    for (; index_it != indices.end(); ++index_it, ++data_it)
       if (*data_it)
         ++used_indices;
   }
@@ -500,12 +618,12 @@ DynamicSparseNumberBase<T,I,SubType>::sparsity_trim ()
 
   // Downward-merged values:
   typename std::vector<T>::iterator md_it = _data.begin();
-  typename std::vector<I>::iterator mi_it = _indices.begin();
+  typename SparsityStorage<I>::type::iterator mi_it = _indices.begin();
 
   // Our old values:
   typename std::vector<T>::const_iterator d_it = _data.begin();
 
-  for (typename std::vector<I>::const_iterator i_it = _indices.begin();
+  for (typename SparsityStorage<I>::type::const_iterator i_it = _indices.begin();
        i_it != _indices.end(); ++i_it, ++d_it)
     if (*d_it)
       {
@@ -525,40 +643,177 @@ DynamicSparseNumberBase<T,I,SubType>::sparsity_trim ()
   _data.resize(n_indices);
 }
 
+
+template <typename T, typename I, template <typename, typename> class SubType>
+inline
+std::size_t
+DynamicSparseNumberBase<T,I,SubType>::sparsity_prune (SparsityPruning& policy)
+{
+  const std::size_t index_size = this->size();
+
+  double max_magnitude = 0;
+  if (policy.relative_tolerance())
+    for (std::size_t i=0; i != index_size; ++i)
+      max_magnitude = std::max(max_magnitude,
+                               PruneMagnitude<T>::value(_data[i]));
+  const double threshold = policy.threshold(max_magnitude);
+
+  // Copy the entries we keep downward into place, leaving a shared
+  // pattern shared if nothing is dropped
+  std::size_t n_kept = 0;
+  for (std::size_t i=0; i != index_size; ++i)
+    if (!PruneMagnitude<T>::negligible(_data[i], threshold))
+      {
+        if (n_kept != i)
+          {
+            _indices[n_kept] = _indices[i];
+            _data[n_kept] = _data[i];
+          }
+        ++n_kept;
+      }
+
+  _indices.resize(n_kept);
+  _data.resize(n_kept);
+
+  policy.record(index_size, index_size - n_kept);
+  return index_size - n_kept;
+}
+
+
+template <typename T, typename I, template <typename, typename> class SubType>
+inline
+std::size_t
+DynamicSparseNumberBase<T,I,SubType>::sparsity_prune (double absolute_tolerance,
+                                                      double relative_tolerance)
+{
+  SparsityPruning policy(absolute_tolerance, relative_tolerance);
+  return this->sparsity_prune(policy);
+}
+
+
+template <typename T, typename I, template <typename, typename> class SubType>
+inline
+void
+DynamicSparseNumberBase<T,I,SubType>::sparsity_prune_active ()
+{
+  if (SparsityPruning* policy = SparsityPruning::active())
+    this->sparsity_prune(*policy);
+}
+
   // Not defineable since !0 != 0
   // SubType<T,I> operator! () const;
 
+// Per-entry operations for the fused union_apply kernel.  Each
+// operation is given our entry and x's entry where both exist, only
+// ours where x has no entry, and only x's where we had no entry.
+
+struct SparsePlusOp
+{
+  template <typename T, typename T2>
+  void operator() (T& y, const T2& x) const { y += x; }
+
+  template <typename T>
+  void self (T&) const {}
+
+  template <typename T, typename T2>
+  void other (T& y, const T2& x) const { y = x; }
+};
+
+struct SparseMinusOp
+{
+  template <typename T, typename T2>
+  void operator() (T& y, const T2& x) const { y -= x; }
+
+  template <typename T>
+  void self (T&) const {}
+
+  template <typename T, typename T2>
+  void other (T& y, const T2& x) const { y = -x; }
+};
+
+// Sums the products of two sparse numbers' entries at common indices,
+// as called by SortedSet::for_each_common
+
+template <typename T, typename T2, typename S>
+struct SparseDotFunctor
+{
+  SparseDotFunctor(const std::vector<T>& a_in, const std::vector<T2>& b_in) :
+    a(a_in), b(b_in), sum(0) {}
+
+  void operator() (std::size_t i, std::size_t j) { sum += a[i] * b[j]; }
+
+  const std::vector<T>& a;
+  const std::vector<T2>& b;
+  S sum;
+};
+
+template <typename TA, typename TB>
+struct SparseAxpbyOp
+{
+  SparseAxpbyOp(const TA& a_in, const TB& b_in) : a(a_in), b(b_in) {}
+
+  template <typename T, typename T2>
+  void operator() (T& y, const T2& x) const { y = y * b + a * x; }
+
+  template <typename T>
+  void self (T& y) const { y *= b; }
+
+  template <typename T, typename T2>
+  void other (T& y, const T2& x) const { y = a * x; }
+
+  const TA& a;
+  const TB& b;
+};
+
+template <typename TA, typename TB>
+struct SparseQuotientOp
+{
+  SparseQuotientOp(const TA& a_in, const TB& b_in) :
+    a(a_in), b(b_in), bb(b_in * b_in) {}
+
+  template <typename T, typename T2>
+  void operator() (T& y, const T2& x) const { y = y / b - x * a / bb; }
+
+  template <typename T>
+  void self (T& y) const { y /= b; }
+
+  template <typename T, typename T2>
+  void other (T& y, const T2& x) const { y = -(x * a / bb); }
+
+  const TA& a;
+  const TB& b;
+  const typename MultipliesType<TB,TB>::supertype bb;
+};
+
+template <typename TA, typename TB>
+struct SparseReverseQuotientOp
+{
+  SparseReverseQuotientOp(const TA& a_in, const TB& b_in) :
+    a(a_in), b(b_in), bb(b_in * b_in) {}
+
+  template <typename T, typename T2>
+  void operator() (T& y, const T2& x) const { y = x / b - y * a / bb; }
+
+  template <typename T>
+  void self (T& y) const { y = -(y * a / bb); }
+
+  template <typename T, typename T2>
+  void other (T& y, const T2& x) const { y = x / b; }
+
+  const TA& a;
+  const TB& b;
+  const typename MultipliesType<TB,TB>::supertype bb;
+};
+
+
 template <typename T, typename I, template <typename, typename> class SubType>
 template <typename T2, typename I2>
 inline
 SubType<T,I>&
 DynamicSparseNumberBase<T,I,SubType>::operator+= (const SubType<T2,I2>& a)
 {
-  // Resize if necessary
-  this->sparsity_union(a.nude_indices());
-
-  typename std::vector<T>::iterator data_it  = _data.begin();
-  typename std::vector<I>::iterator index_it = _indices.begin();
-  typename std::vector<T2>::const_iterator data2_it  =
-    a.nude_data().begin();
-  typename std::vector<I2>::const_iterator index2_it =
-    a.nude_indices().begin();
-  for (; data2_it != a.nude_data().end(); ++data2_it, ++index2_it)
-    {
-      I idx1 = *index_it;
-      I2 idx2 = *index2_it;
-
-      while (idx1 < idx2) {
-        ++index_it;
-        ++data_it;
-        metaphysicl_assert(index_it != _indices.end());
-        idx1 = *index_it;
-      }
-      metaphysicl_assert_equal_to(idx1, idx2);
-
-      *data_it += *data2_it;
-    }
-
+  this->union_apply(a, SparsePlusOp());
+  this->sparsity_prune_active();
   return static_cast<SubType<T,I>&>(*this);
 }
 
@@ -569,31 +824,8 @@ inline
 SubType<T,I>&
 DynamicSparseNumberBase<T,I,SubType>::operator-= (const SubType<T2,I2>& a)
 {
-  // Resize if necessary
-  this->sparsity_union(a.nude_indices());
-
-  typename std::vector<T>::iterator data_it  = _data.begin();
-  typename std::vector<I>::iterator index_it = _indices.begin();
-  typename std::vector<T2>::const_iterator data2_it  =
-    a.nude_data().begin();
-  typename std::vector<I2>::const_iterator index2_it =
-    a.nude_indices().begin();
-  for (; data2_it != a.nude_data().end(); ++data2_it, ++index2_it)
-    {
-      I idx1 = *index_it;
-      I2 idx2 = *index2_it;
-
-      while (idx1 < idx2) {
-        ++index_it;
-        ++data_it;
-        metaphysicl_assert(index_it != _indices.end());
-        idx1 = *index_it;
-      }
-      metaphysicl_assert_equal_to(idx1, idx2);
-
-      *data_it -= *data2_it;
-    }
-
+  this->union_apply(a, SparseMinusOp());
+  this->sparsity_prune_active();
   return static_cast<SubType<T,I>&>(*this);
 }
 
@@ -604,29 +836,36 @@ inline
 SubType<T,I>&
 DynamicSparseNumberBase<T,I,SubType>::operator*= (const SubType<T2,I2>& a)
 {
+  // Operands sharing a pattern need no merge
+  if (same_sparsity(_indices, a.nude_indices()))
+    {
+      const std::size_t index_size = size();
+      for (std::size_t i=0; i != index_size; ++i)
+        _data[i] *= a.raw_at(i);
+      return static_cast<SubType<T,I>&>(*this);
+    }
+
   // Resize if possible
   this->sparsity_intersection(a.nude_indices());
 
+  // Every index we have left is one of a's
+  const typename SparsityStorage<I>::type& indices = _indices;
   typename std::vector<T>::iterator data_it  = _data.begin();
-  typename std::vector<I>::iterator index_it = _indices.begin();
+  typename SparsityStorage<I>::type::const_iterator index_it = indices.begin();
   typename std::vector<T2>::const_iterator data2_it  =
     a.nude_data().begin();
-  typename std::vector<I2>::const_iterator index2_it =
+  typename SparsityStorage<I2>::type::const_iterator index2_it =
     a.nude_indices().begin();
-  for (; data2_it != a.nude_data().end(); ++data2_it, ++index2_it)
+  for (; index_it != indices.end(); ++data_it, ++index_it)
     {
-      I idx1 = *index_it;
-      I2 idx2 = *index2_it;
-
-      while (idx1 < idx2) {
-        ++index_it;
-        ++data_it;
-        metaphysicl_assert(index_it != _indices.end());
-        idx1 = *index_it;
+      while (*index2_it < *index_it) {
+        ++index2_it;
+        ++data2_it;
+        metaphysicl_assert(index2_it != a.nude_indices().end());
       }
+      metaphysicl_assert_equal_to(*index_it, *index2_it);
 
-      if (idx1 == idx2)
-        *data_it *= *data2_it;
+      *data_it *= *data2_it;
     }
 
   return static_cast<SubType<T,I>&>(*this);
@@ -639,25 +878,34 @@ inline
 SubType<T,I>&
 DynamicSparseNumberBase<T,I,SubType>::operator/= (const SubType<T2,I2>& a)
 {
+  // Operands sharing a pattern need no merge
+  if (same_sparsity(_indices, a.nude_indices()))
+    {
+      const std::size_t index_size = size();
+      for (std::size_t i=0; i != index_size; ++i)
+        _data[i] /= a.raw_at(i);
+      return static_cast<SubType<T,I>&>(*this);
+    }
+
+  const typename SparsityStorage<I>::type& indices = _indices;
   typename std::vector<T>::iterator data_it  = _data.begin();
-  typename std::vector<I>::iterator index_it = _indices.begin();
+  typename SparsityStorage<I>::type::const_iterator index_it = indices.begin();
   typename std::vector<T2>::const_iterator data2_it  =
     a.nude_data().begin();
-  typename std::vector<I2>::const_iterator index2_it =
+  typename SparsityStorage<I2>::type::const_iterator index2_it =
     a.nude_indices().begin();
-  for (; data2_it != a.nude_data().end(); ++data2_it, ++index2_it)
+  const typename SparsityStorage<I2>::type::const_iterator index2_end =
+    a.nude_indices().end();
+  for (; index_it != indices.end(); ++data_it, ++index_it)
     {
-      I idx1 = *index_it;
-      I2 idx2 = *index2_it;
-
-      while (idx1 < idx2) {
-        ++index_it;
-        ++data_it;
-        metaphysicl_assert(index_it != _indices.end());
-        idx1 = *index_it;
+      while (index2_it != index2_end && *index2_it < *index_it) {
+        ++index2_it;
+        ++data2_it;
       }
+      if (index2_it == index2_end)
+        break;
 
-      if (idx1 == idx2)
+      if (*index2_it == *index_it)
         *data_it /= *data2_it;
     }
 
@@ -689,6 +937,190 @@ DynamicSparseNumberBase<T,I,SubType>::operator/= (const T2& a)
   return static_cast<SubType<T,I>&>(*this);
 }
 
+template <typename T, typename I, template <typename, typename> class SubType>
+template <typename T2, typename I2, typename Op>
+inline
+void
+DynamicSparseNumberBase<T,I,SubType>::union_apply (const SubType<T2,I2>& x,
+                                                   const Op& op)
+{
+  const typename SparsityStorage<I2>::type& x_indices = x.nude_indices();
+  const std::vector<T2>& x_data = x.nude_data();
+
+  if (same_sparsity(_indices, x_indices))
+    {
+      const std::size_t index_size = this->size();
+      for (std::size_t i=0; i != index_size; ++i)
+        op(_data[i], x_data[i]);
+      return;
+    }
+
+  // Read our pattern through a const reference, so that a shared
+  // pattern is only unshared if it actually changes
+  const typename SparsityStorage<I>::type& old_indices = _indices;
+
+  metaphysicl_assert
+    (std::adjacent_find(old_indices.begin(), old_indices.end()) ==
+     old_indices.end());
+  metaphysicl_assert
+    (std::adjacent_find(x_indices.begin(), x_indices.end()) ==
+     x_indices.end());
+#ifdef METAPHYSICL_HAVE_CXX11
+  metaphysicl_assert(std::is_sorted(old_indices.begin(), old_indices.end()));
+  metaphysicl_assert(std::is_sorted(x_indices.begin(), x_indices.end()));
+#endif
+
+  const std::size_t old_size = this->size();
+  const std::size_t x_size = x_indices.size();
+
+  const bool contiguous = old_size &&
+    std::size_t(old_indices[old_size-1] - old_indices[0]) + 1 == old_size;
+
+  // Indices of x within our contiguous range are found by offset,
+  // and our pattern doesn't change
+  if (contiguous && x_size &&
+      !(x_indices[0] < old_indices[0]) &&
+      !(old_indices[old_size-1] < x_indices[x_size-1]))
+    {
+      const I front = old_indices[0];
+      std::size_t i = 0;
+      for (std::size_t j = 0; j != x_size; ++j)
+        {
+          const std::size_t target = x_indices[j] - front;
+          for (; i != target; ++i)
+            op.self(_data[i]);
+          op(_data[i++], x_data[j]);
+        }
+      for (; i != old_size; ++i)
+        op.self(_data[i]);
+      return;
+    }
+
+  // Contiguous index ranges with a contiguous union line up by
+  // offset, so they merge without any index comparisons
+  if (contiguous && x_size &&
+      std::size_t(x_indices[x_size-1] - x_indices[0]) + 1 == x_size &&
+      !(old_indices[old_size-1] + 1 < x_indices[0]) &&
+      !(x_indices[x_size-1] + 1 < old_indices[0]))
+    {
+      const I front = std::min(old_indices[0], I(x_indices[0]));
+      const std::size_t our_offset = old_indices[0] - front;
+      const std::size_t x_offset = I(x_indices[0]) - front;
+      const std::size_t new_size =
+        std::max(our_offset + old_size, x_offset + x_size);
+
+      this->resize(new_size);
+
+      for (std::size_t out = new_size; out--;)
+        {
+          const bool have_x = out >= x_offset && out < x_offset + x_size;
+          if (out >= our_offset && out < our_offset + old_size)
+            {
+              if (our_offset)
+                {
+                  using std::swap;
+                  swap(_data[out], _data[out - our_offset]);
+                }
+              if (have_x)
+                op(_data[out], x_data[out - x_offset]);
+              else
+                op.self(_data[out]);
+            }
+          else
+            op.other(_data[out], x_data[out - x_offset]);
+          _indices[out] = front + out;
+        }
+      return;
+    }
+
+  // First count the indices we don't have yet
+  const std::size_t unseen_indices = x_size -
+    SortedSet::intersection_size(old_indices.begin(), old_indices.end(),
+                                 x_indices.begin(), x_indices.end());
+
+  // The common case, an unchanged pattern, doesn't reallocate
+  this->resize(old_size + unseen_indices);
+
+  // Then merge from the back, so that we never overwrite one of our
+  // old entries before we've moved it.  Every slot below out is
+  // rewritten later, so swapping old entries into place is safe.
+  std::size_t i = old_size, j = x_indices.size(), out = this->size();
+  while (out)
+    {
+      --out;
+      if (j && (!i || x_indices[j-1] > _indices[i-1]))
+        {
+          --j;
+          _indices[out] = x_indices[j];
+          op.other(_data[out], x_data[j]);
+        }
+      else
+        {
+          --i;
+          if (out != i)
+            {
+              using std::swap;
+              _indices[out] = _indices[i];
+              swap(_data[out], _data[i]);
+            }
+          if (j && x_indices[j-1] == _indices[out])
+            {
+              --j;
+              op(_data[out], x_data[j]);
+            }
+          else
+            op.self(_data[out]);
+        }
+    }
+
+  metaphysicl_assert_equal_to(i, 0);
+  metaphysicl_assert_equal_to(j, 0);
+
+  this->sparsity_adapt();
+}
+
+
+template <typename T, typename I, template <typename, typename> class SubType>
+template <typename TA, typename T2, typename I2, typename TB>
+inline
+SubType<T,I>&
+DynamicSparseNumberBase<T,I,SubType>::axpby (const TA& a,
+                                             const SubType<T2,I2>& x,
+                                             const TB& b)
+{
+  this->union_apply(x, SparseAxpbyOp<TA,TB>(a, b));
+  this->sparsity_prune_active();
+  return static_cast<SubType<T,I>&>(*this);
+}
+
+
+template <typename T, typename I, template <typename, typename> class SubType>
+template <typename TA, typename T2, typename I2, typename TB>
+inline
+SubType<T,I>&
+DynamicSparseNumberBase<T,I,SubType>::quotient_update (const TA& a,
+                                                       const SubType<T2,I2>& x,
+                                                       const TB& b)
+{
+  this->union_apply(x, SparseQuotientOp<TA,TB>(a, b));
+  this->sparsity_prune_active();
+  return static_cast<SubType<T,I>&>(*this);
+}
+
+
+template <typename T, typename I, template <typename, typename> class SubType>
+template <typename TA, typename T2, typename I2, typename TB>
+inline
+SubType<T,I>&
+DynamicSparseNumberBase<T,I,SubType>::reverse_quotient_update (const TA& a,
+                                                               const SubType<T2,I2>& x,
+                                                               const TB& b)
+{
+  this->union_apply(x, SparseReverseQuotientOp<TA,TB>(a, b));
+  this->sparsity_prune_active();
+  return static_cast<SubType<T,I>&>(*this);
+}
+
 //
 // Non-member functions
 //
@@ -729,13 +1161,13 @@ if_else (const DynamicSparseNumberBase<B, IB,SubType> & condition,
   // First count returnval size
   IS required_size = 0;
   {
-    typename std::vector<IB>::const_iterator indexcond_it      = condition.nude_indices().begin();
+    typename SparsityStorage<IB>::type::const_iterator indexcond_it      = condition.nude_indices().begin();
     typename std::vector<B>::const_iterator datacond_it        = condition.nude_data().begin();
-    typename std::vector<I>::const_iterator indextrue_it       = if_true.nude_indices().begin();
-    const typename std::vector<I>::const_iterator endtrue_it   = if_true.nude_indices().end();
+    typename SparsityStorage<I>::type::const_iterator indextrue_it       = if_true.nude_indices().begin();
+    const typename SparsityStorage<I>::type::const_iterator endtrue_it   = if_true.nude_indices().end();
     typename std::vector<T>::const_iterator datatrue_it        = if_true.nude_data().begin();
-    typename std::vector<I2>::const_iterator indexfalse_it     = if_false.nude_indices().begin();
-    const typename std::vector<I2>::const_iterator endfalse_it = if_false.nude_indices().end();
+    typename SparsityStorage<I2>::type::const_iterator indexfalse_it     = if_false.nude_indices().begin();
+    const typename SparsityStorage<I2>::type::const_iterator endfalse_it = if_false.nude_indices().end();
     typename std::vector<T2>::const_iterator datafalse_it      = if_false.nude_data().begin();
 
     for (; indexcond_it != condition.nude_indices().end(); ++indexcond_it, ++datacond_it)
@@ -789,16 +1221,16 @@ if_else (const DynamicSparseNumberBase<B, IB,SubType> & condition,
   // Then fill returnval
   returnval.resize(required_size);
   {
-    typename std::vector<IB>::const_iterator indexcond_it      = condition.nude_indices().begin();
+    typename SparsityStorage<IB>::type::const_iterator indexcond_it      = condition.nude_indices().begin();
     typename std::vector<B>::const_iterator datacond_it        = condition.nude_data().begin();
-    typename std::vector<I>::const_iterator indextrue_it       = if_true.nude_indices().begin();
-    const typename std::vector<I>::const_iterator endtrue_it   = if_true.nude_indices().end();
+    typename SparsityStorage<I>::type::const_iterator indextrue_it       = if_true.nude_indices().begin();
+    const typename SparsityStorage<I>::type::const_iterator endtrue_it   = if_true.nude_indices().end();
     typename std::vector<T>::const_iterator datatrue_it        = if_true.nude_data().begin();
-    typename std::vector<I2>::const_iterator indexfalse_it     = if_false.nude_indices().begin();
-    const typename std::vector<I2>::const_iterator endfalse_it = if_false.nude_indices().end();
+    typename SparsityStorage<I2>::type::const_iterator indexfalse_it     = if_false.nude_indices().begin();
+    const typename SparsityStorage<I2>::type::const_iterator endfalse_it = if_false.nude_indices().end();
     typename std::vector<T2>::const_iterator datafalse_it      = if_false.nude_data().begin();
 
-    typename std::vector<IS>::iterator indexreturn_it          = returnval.nude_indices().begin();
+    typename SparsityStorage<IS>::type::iterator indexreturn_it          = returnval.nude_indices().begin();
     typename std::vector<TS>::iterator datareturn_it           = returnval.nude_data().begin();
 
     for (; indexcond_it != condition.nude_indices().end(); ++indexcond_it, ++datacond_it)
@@ -911,6 +1343,36 @@ DynamicSparseNumberBase_op_ab(opname, subtypename<T MacroComma I>, subtypename<T
 
 #endif
 
+// DualNumber product and quotient rules, done in place
+
+#define DynamicSparseNumberBase_dual_updates(subtypename) \
+template <typename T, typename I, typename TA, typename T2, typename I2, typename TB> \
+inline \
+void \
+dual_product_update (subtypename<T,I>& da, const TA& a, \
+                     const subtypename<T2,I2>& db, const TB& b) \
+{ \
+  da.axpby(a, db, b); \
+} \
+ \
+template <typename T, typename I, typename TA, typename T2, typename I2, typename TB> \
+inline \
+void \
+dual_quotient_update (subtypename<T,I>& da, const TA& a, \
+                      const subtypename<T2,I2>& db, const TB& b) \
+{ \
+  da.quotient_update(a, db, b); \
+} \
+ \
+template <typename T, typename I, typename TA, typename T2, typename I2, typename TB> \
+inline \
+void \
+dual_reverse_quotient_update (subtypename<T,I>& db, const TA& a, \
+                              const subtypename<T2,I2>& da, const TB& b) \
+{ \
+  db.reverse_quotient_update(a, da, b); \
+}
+
 // Let's also allow scalar times vector.
 // Scalar plus vector, etc. remain undefined in the sparse context.
 
@@ -924,12 +1386,11 @@ operator * (const T& a, const DynamicSparseNumberBase<T2,I,SubType>& b)
 
   typename MultipliesType<SubType<T2,I>,T,true>::supertype
     returnval;
-  returnval.resize(index_size);
+  returnval.nude_indices() = b.nude_indices();
+  returnval.nude_data().resize(index_size);
 
-  for (unsigned int i=0; i != index_size; ++i) {
+  for (unsigned int i=0; i != index_size; ++i)
     returnval.raw_at(i) = a * b.raw_at(i);
-    returnval.raw_index(i) = b.raw_index(i);
-  }
 
   return returnval;
 }
@@ -944,12 +1405,11 @@ operator * (const DynamicSparseNumberBase<T,I,SubType>& a, const T2& b)
 
   typename MultipliesType<SubType<T,I>,T2>::supertype
     returnval;
-  returnval.resize(index_size);
+  returnval.nude_indices() = a.nude_indices();
+  returnval.nude_data().resize(index_size);
 
-  for (unsigned int i=0; i != index_size; ++i) {
+  for (unsigned int i=0; i != index_size; ++i)
     returnval.raw_at(i) = a.raw_at(i) * b;
-    returnval.raw_index(i) = a.raw_index(i);
-  }
   return returnval;
 }
 
@@ -962,12 +1422,11 @@ operator / (const DynamicSparseNumberBase<T,I,SubType>& a, const T2& b)
   const unsigned int index_size = a.size();
 
   typename DividesType<SubType<T,I>,T2>::supertype returnval;
-  returnval.resize(index_size);
+  returnval.nude_indices() = a.nude_indices();
+  returnval.nude_data().resize(index_size);
 
-  for (unsigned int i=0; i != index_size; ++i) {
+  for (unsigned int i=0; i != index_size; ++i)
     returnval.raw_at(i) = a.raw_at(i) / b;
-    returnval.raw_index(i) = a.raw_index(i);
-  }
 
   return returnval;
 }
@@ -1013,53 +1472,40 @@ operator opname (const DynamicSparseNumberBase<T,I,SubType>& a, \
 { \
   typedef typename SymmetricCompareTypes<T,T2>::supertype TS; \
   typedef typename CompareTypes<I,I2>::supertype IS; \
-  SubType<bool, IS> returnval; \
-  returnval.nude_indices() = a.nude_indices(); \
-  returnval.nude_data().resize(a.nude_indices().size()); \
-  returnval.sparsity_union(b.nude_indices()); \
- \
-  typename std::vector<I>::const_iterator  index_a_it = a.nude_indices().begin(); \
-  typename std::vector<I2>::const_iterator index_b_it = b.nude_indices().begin(); \
-  typename std::vector<IS>::iterator     index_out_it = returnval.nude_indices().begin(); \
+  const typename SparsityStorage<I>::type& index_a = a.nude_indices(); \
+  const typename SparsityStorage<I2>::type& index_b = b.nude_indices(); \
+  const std::size_t size_a = index_a.size(), size_b = index_b.size(); \
  \
-  typename std::vector<T>::const_iterator  data_a_it = a.nude_data().begin(); \
-  typename std::vector<T2>::const_iterator data_b_it = b.nude_data().begin(); \
-  typename std::vector<TS>::iterator     data_out_it = returnval.nude_data().begin(); \
- \
-  const IS  maxIS  = std::numeric_limits<IS>::max(); \
- \
-  for (; index_out_it != returnval.nude_indices().end(); ++index_out_it, ++data_out_it) { \
-    const IS index_a = (index_a_it == a.nude_indices().end()) ? maxIS : *index_a_it; \
-    const IS index_b = (index_b_it == b.nude_indices().end()) ? maxIS : *index_b_it; \
-    const IS index_out = *index_out_it; \
-    const TS data_a  = (index_a_it == a.nude_indices().end()) ? 0: *data_a_it; \
-    const TS data_b  = (index_b_it == b.nude_indices().end()) ? 0: *data_b_it; \
-    typename std::vector<TS>::reference data_out = *data_out_it; \
+  SubType<bool, IS> returnval; \
+  returnval.resize(SortedSet::union_size(index_a.begin(), index_a.end(), \
+                                         index_b.begin(), index_b.end())); \
  \
-    if (index_a == index_out) { \
-      if (index_b == index_out) { \
-        data_out = data_a opname data_b; \
-        index_b_it++; \
-        data_b_it++; \
-      } else { \
-        data_out = data_a opname 0; \
-      } \
-      index_a_it++; \
-      data_a_it++; \
-    } else { \
-      metaphysicl_assert_equal_to(index_b, index_out); \
-      data_out = 0 opname data_b; \
-      index_b_it++; \
-      data_b_it++; \
+  std::size_t i_a = 0, i_b = 0; \
+  for (std::size_t i = 0; i != returnval.size(); ++i) \
+    { \
+      if (i_b == size_b || (i_a != size_a && index_a[i_a] < index_b[i_b])) \
+        { \
+          returnval.raw_index(i) = index_a[i_a]; \
+          returnval.raw_at(i) = (a.raw_at(i_a++) opname TS(0)); \
+        } \
+      else if (i_a == size_a || index_b[i_b] < index_a[i_a]) \
+        { \
+          returnval.raw_index(i) = index_b[i_b]; \
+          returnval.raw_at(i) = (TS(0) opname b.raw_at(i_b++)); \
+        } \
+      else \
+        { \
+          returnval.raw_index(i) = index_a[i_a]; \
+          returnval.raw_at(i) = (a.raw_at(i_a++) opname b.raw_at(i_b++)); \
+        } \
     } \
-  } \
  \
   return returnval; \
 } \
 template <template <typename, typename> class SubType, \
           typename T, typename T2, typename I> \
 inline \
-SubType<bool, I> \
+typename boostcopy::enable_if<BuiltinTraits<T2>, SubType<bool, I> >::type \
 operator opname (const DynamicSparseNumberBase<T,I,SubType>& a, const T2& b) \
 { \
   SubType<bool, I> returnval; \
@@ -1076,13 +1522,13 @@ operator opname (const DynamicSparseNumberBase<T,I,SubType>& a, const T2& b) \
 template <template <typename, typename> class SubType, \
           typename T, typename T2, typename I> \
 inline \
-SubType<bool, I> \
+typename boostcopy::enable_if<BuiltinTraits<T>, SubType<bool, I> >::type \
 operator opname (const T& a, const DynamicSparseNumberBase<T2,I,SubType>& b) \
 { \
   SubType<bool, I> returnval; \
  \
-  std::size_t index_size = a.size(); \
-  returnval.nude_indices() = a.nude_indices(); \
+  std::size_t index_size = b.size(); \
+  returnval.nude_indices() = b.nude_indices(); \
   returnval.nude_data().resize(index_size); \
  \
   for (unsigned int i=0; i != index_size; ++i) \
@@ -1134,12 +1580,121 @@ operator<< (std::ostream& output, const DynamicSparseNumberBase<T,I,SubType>& a)
   return output;
 }
 
+
+template <template <typename, typename> class SubType,
+          typename T, typename I, typename F>
+inline
+SubType<T, I>
+sparse_apply (const DynamicSparseNumberBase<T,I,SubType>& a, F f)
+{
+  const std::size_t index_size = a.size();
+  SubType<T,I> returnval;
+  returnval.nude_indices() = a.nude_indices();
+  returnval.nude_data().resize(index_size);
+  const T * in = a.raw_data();
+  T * out = returnval.raw_data();
+  for (std::size_t i=0; i != index_size; ++i)
+    out[i] = f(in[i]);
+
+  return returnval;
+}
+
+
+template <template <typename, typename> class SubType,
+          typename T, typename I, typename I2, typename F>
+inline
+SubType<T, I>
+dense_apply (const DynamicSparseNumberBase<T,I,SubType>& a,
+             I2 first, I2 last, F f)
+{
+  metaphysicl_assert_less_equal(first, last);
+
+  const I begin = first;
+  const std::size_t range_size = last - first;
+  SubType<T,I> returnval;
+  returnval.nude_indices().resize(range_size);
+  for (std::size_t i=0; i != range_size; ++i)
+    returnval.nude_indices()[i] = begin + i;
+  returnval.nude_data().assign(range_size, f(T(0)));
+
+  T * out = returnval.raw_data();
+  const std::size_t index_size = a.size();
+  for (std::size_t i=0; i != index_size; ++i)
+    {
+      const I index = a.raw_index(i);
+      metaphysicl_assert_greater_equal(index, begin);
+      metaphysicl_assert_less(std::size_t(index - begin), range_size);
+      out[index - begin] = f(a.raw_at(i));
+    }
+
+  return returnval;
+}
+
+
+template <template <typename, typename> class SubType,
+          typename T, typename T2, typename I, typename I2,
+          typename I3, typename F>
+inline
+SubType<typename SymmetricCompareTypes<T,T2>::supertype,
+        typename CompareTypes<I,I2>::supertype>
+dense_apply (const DynamicSparseNumberBase<T,I,SubType>& a,
+             const DynamicSparseNumberBase<T2,I2,SubType>& b,
+             I3 first, I3 last, F f)
+{
+  typedef typename SymmetricCompareTypes<T,T2>::supertype TS;
+  typedef typename CompareTypes<I,I2>::supertype IS;
+
+  metaphysicl_assert_less_equal(first, last);
+
+  const IS begin = first;
+  const std::size_t range_size = last - first;
+  SubType<TS,IS> returnval;
+  returnval.nude_indices().resize(range_size);
+  for (std::size_t i=0; i != range_size; ++i)
+    returnval.nude_indices()[i] = begin + i;
+  returnval.nude_data().assign(range_size, f(TS(0), TS(0)));
+
+  // Indices b doesn't store read it as 0, and vice versa
+  TS * out = returnval.raw_data();
+  const std::size_t a_size = a.size(), b_size = b.size();
+  std::size_t i = 0, j = 0;
+  while (i != a_size || j != b_size)
+    {
+      IS index;
+      TS a_value = 0, b_value = 0;
+      if (j == b_size ||
+          (i != a_size && IS(a.raw_index(i)) < IS(b.raw_index(j))))
+        {
+          index = a.raw_index(i);
+          a_value = a.raw_at(i++);
+        }
+      else if (i == a_size || IS(b.raw_index(j)) < IS(a.raw_index(i)))
+        {
+          index = b.raw_index(j);
+          b_value = b.raw_at(j++);
+        }
+      else
+        {
+          index = a.raw_index(i);
+          a_value = a.raw_at(i++);
+          b_value = b.raw_at(j++);
+        }
+
+      metaphysicl_assert_greater_equal(index, begin);
+      metaphysicl_assert_less(std::size_t(index - begin), range_size);
+      out[index - begin] = f(a_value, b_value);
+    }
+
+  return returnval;
+}
+
 } // namespace MetaPhysicL
 
 namespace std {
 
 using MetaPhysicL::CompareTypes;
 using MetaPhysicL::DynamicSparseNumberBase;
+using MetaPhysicL::SparsityStorage;
 using MetaPhysicL::SymmetricCompareTypes;
 
 #define DynamicSparseNumberBase_std_unary(funcname) \
@@ -1149,12 +1704,14 @@ inline \
 SubType<T, I> \
 funcname (const DynamicSparseNumberBase<T,I,SubType> & a) \
 { \
-  std::size_t index_size = a.size(); \
+  const std::size_t index_size = a.size(); \
   SubType<T,I> returnval; \
   returnval.nude_indices() = a.nude_indices(); \
   returnval.nude_data().resize(index_size); \
-  for (unsigned int i=0; i != index_size; ++i) \
-    returnval.raw_at(i) = std::funcname(a.raw_at(i)); \
+  const T * in = a.raw_data(); \
+  T * out = returnval.raw_data(); \
+  for (std::size_t i=0; i != index_size; ++i) \
+    out[i] = std::funcname(in[i]); \
  \
   return returnval; \
 }
@@ -1170,7 +1727,42 @@ DynamicSparseNumberBase_std_unary(funcname) \
 DynamicSparseNumberBase_fl_unary(funcname)
 
 
+#if __cplusplus >= 201103L
+// Functions with f(0) != 0 would fill in every index a sparse number
+// doesn't store, so we make calling them a readable compile-time
+// error rather than a missing overload.
+#define DynamicSparseNumberBase_std_dense_unary(funcname) \
+template <template <typename, typename> class SubType, \
+          typename T, typename I> \
+inline \
+SubType<T, I> \
+funcname (const DynamicSparseNumberBase<T,I,SubType> &) \
+{ \
+  static_assert(sizeof(T) == 0, \
+                #funcname "(0) != 0 is not sparse; use " \
+                "MetaPhysicL::dense_apply() over an explicit index range"); \
+  return SubType<T,I>(); \
+}
+
+#define DynamicSparseNumberBase_stdfl_dense_unary(funcname) \
+DynamicSparseNumberBase_std_dense_unary(funcname) \
+DynamicSparseNumberBase_std_dense_unary(funcname##f) \
+DynamicSparseNumberBase_std_dense_unary(funcname##l)
+#endif // __cplusplus >= 201103L
+
+
+// Binary functions are evaluated over the union of the operands'
+// sparsity patterns, in one merge pass writing straight into the
+// result, with missing entries of either operand read as 0.  Indices
+// neither operand stores stay unstored.  That is exact when
+// f(0,0) == 0; for pow, fmod and remainder it leaves out f(0,0) at
+// those indices, and MetaPhysicL::dense_apply() over an explicit index
+// range fills them in.
 #define DynamicSparseNumberBase_std_binary_union(funcname) \
+DynamicSparseNumberBase_std_binary_merge(funcname) \
+DynamicSparseNumberBase_std_binary_scalar(funcname)
+
+#define DynamicSparseNumberBase_std_binary_merge(funcname) \
 template <template <typename, typename> class SubType, \
           typename T, typename T2, typename I, typename I2> \
 inline \
@@ -1181,67 +1773,93 @@ funcname (const DynamicSparseNumberBase<T,I,SubType>& a, \
 { \
   typedef typename SymmetricCompareTypes<T,T2>::supertype TS; \
   typedef typename CompareTypes<I,I2>::supertype IS; \
-  SubType<TS, IS> returnval; \
- \
-  std::size_t index_size = a.nude_indices.size(); \
-  returnval.nude_indices = a.nude_indices; \
-  returnval.nude_data.resize(index_size); \
-  returnval.sparsity_union(b.nude_indices); \
  \
-  typename std::vector<I>::const_iterator  index_a_it = a.nude_indices.begin(); \
-  typename std::vector<I2>::const_iterator index_b_it = b.nude_indices.begin(); \
-  typename std::vector<IS>::iterator     index_out_it = returnval.nude_indices.begin(); \
+  const typename SparsityStorage<I>::type&  a_indices = a.nude_indices(); \
+  const typename SparsityStorage<I2>::type& b_indices = b.nude_indices(); \
+  const std::size_t a_size = a_indices.size(); \
+  const std::size_t b_size = b_indices.size(); \
+  const T  * a_data = a.raw_data(); \
+  const T2 * b_data = b.raw_data(); \
  \
-  typename std::vector<T>::const_iterator  data_a_it = a.nude_data.begin(); \
-  typename std::vector<T2>::const_iterator data_b_it = b.nude_data.begin(); \
-  typename std::vector<TS>::iterator     data_out_it = returnval.nude_data.begin(); \
+  SubType<TS, IS> returnval; \
  \
-  const IS  maxIS  = std::numeric_limits<IS>::max(); \
+  /* Operands sharing a pattern need no merge */ \
+  if (MetaPhysicL::same_sparsity(a_indices, b_indices)) \
+    { \
+      returnval.resize(a_size); \
+      typename SparsityStorage<IS>::type& out_indices = returnval.nude_indices(); \
+      TS * out_data = returnval.raw_data(); \
+      for (std::size_t i=0; i != a_size; ++i) \
+        { \
+          out_indices[i] = a_indices[i]; \
+          out_data[i] = std::funcname(TS(a_data[i]), TS(b_data[i])); \
+        } \
+      return returnval; \
+    } \
  \
-  for (; index_out_it != returnval.nude_indices.end(); ++index_out_it, ++data_out_it) { \
-    const IS index_a = (index_a_it == a.nude_indices.end()) ? maxIS : *index_a_it; \
-    const IS index_b = (index_b_it == b.nude_indices.end()) ? maxIS : *index_b_it; \
-    const IS index_out = *index_out_it; \
-    const TS data_a  = (index_a_it == a.nude_indices.end()) ? 0: *data_a_it; \
-    const TS data_b  = (index_b_it == b.nude_indices.end()) ? 0: *data_b_it; \
-    typename std::vector<TS>::reference data_out = *data_out_it; \
+  returnval.resize(a_size + b_size); \
+  typename SparsityStorage<IS>::type& out_indices = returnval.nude_indices(); \
+  TS * out_data = returnval.raw_data(); \
  \
-    if (index_a == index_out) { \
-      if (index_b == index_out) { \
-        data_out = std::funcname(data_a, data_b); \
-        index_b_it++; \
-        data_b_it++; \
-      } else { \
-        data_out = std::funcname(data_a, 0); \
-      } \
-      index_a_it++; \
-      data_a_it++; \
-    } else { \
-      metaphysicl_assert_equal_to(index_b, index_out); \
-      data_out = std::funcname(0, data_b); \
-      index_b_it++; \
-      data_b_it++; \
+  std::size_t i = 0, j = 0, k = 0; \
+  for (; i != a_size && j != b_size; ++k) \
+    { \
+      const IS index_a = a_indices[i]; \
+      const IS index_b = b_indices[j]; \
+      if (index_a < index_b) \
+        { \
+          out_indices[k] = index_a; \
+          out_data[k] = std::funcname(TS(a_data[i++]), TS(0)); \
+        } \
+      else if (index_b < index_a) \
+        { \
+          out_indices[k] = index_b; \
+          out_data[k] = std::funcname(TS(0), TS(b_data[j++])); \
+        } \
+      else \
+        { \
+          out_indices[k] = index_a; \
+          out_data[k] = std::funcname(TS(a_data[i++]), TS(b_data[j++])); \
+        } \
+    } \
+  for (; i != a_size; ++i, ++k) \
+    { \
+      out_indices[k] = a_indices[i]; \
+      out_data[k] = std::funcname(TS(a_data[i]), TS(0)); \
+    } \
+  for (; j != b_size; ++j, ++k) \
+    { \
+      out_indices[k] = b_indices[j]; \
+      out_data[k] = std::funcname(TS(0), TS(b_data[j])); \
     } \
-  } \
  \
+  returnval.resize(k); \
   return returnval; \
-} \
- \
+}
+
+// With one scalar operand f is evaluated at the indices the sparse
+// operand stores, and the result keeps its pattern.  Where f(0,b) != 0,
+// as for max(a,2.) or fmod(a,0.), the indices it doesn't store are
+// left out just as above; dense_apply() gives the dense result.
+#define DynamicSparseNumberBase_std_binary_scalar(funcname) \
 template <template <typename, typename> class SubType, \
           typename T, typename T2, typename I> \
 inline \
-SubType<typename SymmetricCompareTypes<T,T2>::supertype, I> \
+SubType<typename SymmetricCompareTypes \
+  <T, typename MetaPhysicL::boostcopy::enable_if \
+        <MetaPhysicL::BuiltinTraits<T2>, T2>::type>::supertype, I> \
 funcname (const DynamicSparseNumberBase<T,I,SubType>& a, const T2& b) \
 { \
   typedef typename SymmetricCompareTypes<T,T2>::supertype TS; \
   SubType<TS, I> returnval; \
  \
-  std::size_t index_size = a.size(); \
-  returnval.resize(index_size); \
-  returnval.nude_indices = a.nude_indices; \
- \
-  for (unsigned int i=0; i != index_size; ++i) \
-    returnval.raw_at(i) = std::funcname(a.raw_at(i), b); \
+  const std::size_t index_size = a.size(); \
+  returnval.nude_indices() = a.nude_indices(); \
+  returnval.nude_data().resize(index_size); \
+  const T * in = a.raw_data(); \
+  TS * out = returnval.raw_data(); \
+  for (std::size_t i=0; i != index_size; ++i) \
+    out[i] = std::funcname(TS(in[i]), TS(b)); \
  \
   return returnval; \
 } \
@@ -1249,18 +1867,21 @@ funcname (const DynamicSparseNumberBase<T,I,SubType>& a, const T2& b) \
 template <template <typename, typename> class SubType, \
           typename T, typename T2, typename I> \
 inline \
-SubType<typename SymmetricCompareTypes<T,T2>::supertype, I> \
+SubType<typename SymmetricCompareTypes \
+  <typename MetaPhysicL::boostcopy::enable_if \
+     <MetaPhysicL::BuiltinTraits<T>, T>::type, T2>::supertype, I> \
 funcname (const T& a, const DynamicSparseNumberBase<T2,I,SubType>& b) \
 { \
   typedef typename SymmetricCompareTypes<T,T2>::supertype TS; \
   SubType<TS, I> returnval; \
  \
-  std::size_t index_size = a.size(); \
-  returnval.resize(index_size); \
-  returnval.nude_indices = b.nude_indices; \
- \
-  for (unsigned int i=0; i != index_size; ++i) \
-    returnval.raw_at(i) = std::funcname(a, b.raw_at(i)); \
+  const std::size_t index_size = b.size(); \
+  returnval.nude_indices() = b.nude_indices(); \
+  returnval.nude_data().resize(index_size); \
+  const T2 * in = b.raw_data(); \
+  TS * out = returnval.raw_data(); \
+  for (std::size_t i=0; i != index_size; ++i) \
+    out[i] = std::funcname(TS(a), TS(in[i])); \
  \
   return returnval; \
 }
@@ -1276,33 +1897,61 @@ DynamicSparseNumberBase_std_binary_union(funcname) \
 DynamicSparseNumberBase_fl_binary_union(funcname)
 
 
+// std::max and std::min on two operands of one type are exact
+// matches, so each subtype needs overloads more specialized than
+// those to reach ours.
+#define DynamicSparseNumberBase_std_minmax_subtype(funcname, subtypename) \
+template <typename T, typename I> \
+inline \
+subtypename<T, I> \
+funcname (const subtypename<T,I>& a, const subtypename<T,I>& b) \
+{ \
+  return std::funcname<subtypename, T, T, I, I>(a, b); \
+}
+
+#define DynamicSparseNumberBase_std_minmax(subtypename) \
+DynamicSparseNumberBase_std_minmax_subtype(max, subtypename) \
+DynamicSparseNumberBase_std_minmax_subtype(min, subtypename)
+
+
 // Pow needs its own specialization, both to avoid being confused by
-// pow<T1,T2> and because pow(x,0) isn't 0.
-template <template <typename, typename> class SubType, \
+// pow<T1,T2> and because pow(x,0) isn't 0.  The exponent is
+// classified once, for every entry.
+template <template <typename, typename> class SubType,
           typename T, typename T2, typename I>
 inline
-SubType<typename SymmetricCompareTypes<T,T2>::supertype, I>
+SubType<typename SymmetricCompareTypes
+  <T, typename MetaPhysicL::boostcopy::enable_if
+        <MetaPhysicL::BuiltinTraits<T2>, T2>::type>::supertype, I>
 pow (const DynamicSparseNumberBase<T,I,SubType>& a, const T2& b)
 {
   typedef typename SymmetricCompareTypes<T,T2>::supertype TS;
   SubType<TS, I> returnval;
 
-  std::size_t index_size = a.size();
+  const std::size_t index_size = a.size();
   returnval.nude_indices() = a.nude_indices();
   returnval.nude_data().resize(index_size);
-
-  for (unsigned int i=0; i != index_size; ++i)
-    returnval.raw_at(i) = std::pow(a.raw_at(i), b);
+  const T * in = a.raw_data();
+  TS * out = returnval.raw_data();
+  const MetaPhysicL::FixedExponentPow<TS> powb(b);
+  for (std::size_t i=0; i != index_size; ++i)
+    out[i] = powb(TS(in[i]));
 
   return returnval;
 }
 
 
-// NOTE: unary functions for which f(0) != 0 are undefined compile-time
-// errors, because there's no efficient way to have them make sense in
-// the sparse context.
+// pow(0,0) == 1 at every index neither operand stores, which the
+// result leaves out; see the union functions above.
+DynamicSparseNumberBase_std_binary_merge(pow)
+
 
-// DynamicSparseNumberBase_std_binary(pow) // separate definition
+// NOTE: unary functions for which f(0) != 0 are compile-time errors,
+// because there's no efficient way to have them make sense in the
+// sparse context.  MetaPhysicL::dense_apply() evaluates them over an
+// explicit index range instead.
+
+// DynamicSparseNumberBase_std_binary_union(pow) // separate definition
 // DynamicSparseNumberBase_std_unary(exp)
 // DynamicSparseNumberBase_std_unary(log)
 // DynamicSparseNumberBase_std_unary(log10)
@@ -1323,13 +1972,24 @@ DynamicSparseNumberBase_std_binary_union(max)
 DynamicSparseNumberBase_std_binary_union(min)
 DynamicSparseNumberBase_std_unary(ceil)
 DynamicSparseNumberBase_std_unary(floor)
-DynamicSparseNumberBase_std_binary_union(fmod) // TODO: optimize this
 
 #if __cplusplus >= 201103L
+DynamicSparseNumberBase_stdfl_dense_unary(exp)
+DynamicSparseNumberBase_stdfl_dense_unary(exp2)
+DynamicSparseNumberBase_stdfl_dense_unary(log)
+DynamicSparseNumberBase_stdfl_dense_unary(log10)
+DynamicSparseNumberBase_stdfl_dense_unary(log2)
+DynamicSparseNumberBase_stdfl_dense_unary(cos)
+DynamicSparseNumberBase_stdfl_dense_unary(acos)
+DynamicSparseNumberBase_stdfl_dense_unary(cosh)
+DynamicSparseNumberBase_stdfl_dense_unary(acosh)
+DynamicSparseNumberBase_stdfl_dense_unary(erfc)
+
 DynamicSparseNumberBase_std_unary(llabs)
 DynamicSparseNumberBase_std_unary(imaxabs)
 DynamicSparseNumberBase_fl_unary(fabs)
 DynamicSparseNumberBase_stdfl_unary(expm1)
+DynamicSparseNumberBase_stdfl_unary(log1p)
 DynamicSparseNumberBase_fl_unary(sqrt)
 DynamicSparseNumberBase_stdfl_unary(cbrt)
 DynamicSparseNumberBase_fl_unary(sin)
@@ -1346,8 +2006,8 @@ DynamicSparseNumberBase_stdfl_unary(round)
 DynamicSparseNumberBase_stdfl_unary(nearbyint)
 DynamicSparseNumberBase_stdfl_unary(rint)
 
-DynamicSparseNumberBase_fl_binary_union(fmod)
-DynamicSparseNumberBase_stdfl_binary_union(remainder) // TODO: optimize this
+DynamicSparseNumberBase_stdfl_binary_union(fmod)
+DynamicSparseNumberBase_stdfl_binary_union(remainder)
 DynamicSparseNumberBase_stdfl_binary_union(fmax)
 DynamicSparseNumberBase_stdfl_binary_union(fmin)
 DynamicSparseNumberBase_stdfl_binary_union(fdim)
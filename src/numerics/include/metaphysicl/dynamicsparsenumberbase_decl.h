@@ -39,11 +39,31 @@
 #include "metaphysicl/ct_set.h"
 #include "metaphysicl/metaphysicl_asserts.h"
 #include "metaphysicl/raw_type.h"
+#include "metaphysicl/sortedset.h"
 #include "metaphysicl/sparsenumberutils.h"
+#include "metaphysicl/sparsitypattern.h"
+#include "metaphysicl/sparsitypruning.h"
 #include "metaphysicl/testable.h"
 
 namespace MetaPhysicL {
 
+// The fill ratio, over the span from its lowest to its highest
+// index, at which a sparse number stores every index in that span
+// explicitly rather than only the ones it has been given.  Operations
+// on contiguous index ranges need no index comparisons.  Ratios above
+// 1, like the default, never densify.
+//
+// Specializing this for e.g. DynamicSparseNumberArray<T,I> with one
+// index type I, with a ratio like 0.5, makes those sparse numbers
+// hybrids: dense loops over contiguous runs once they fill in, and
+// sorted sparse storage otherwise.  sparsity_trim() returns a
+// densified number to sparse storage.
+template <typename S>
+struct DensifyThreshold
+{
+  static double value() { return 2; }
+};
+
 // Data type T, index type I
 template <typename T, typename I, template <typename, typename> class SubType>
 class DynamicSparseNumberBase
@@ -99,9 +119,9 @@ public:
 
   std::vector<T>& nude_data();
 
-  const std::vector<I>& nude_indices() const;
+  const typename SparsityStorage<I>::type& nude_indices() const;
 
-  std::vector<I>& nude_indices();
+  typename SparsityStorage<I>::type& nude_indices();
 
   std::size_t runtime_index_query(index_value_type i) const;
 
@@ -125,24 +145,61 @@ public:
   template <unsigned int i, typename T2>
   void set(const T2& val);
 
+  // Bulk insertion: equivalent to insert(indices[k]) += values[k]
+  // for each k < n, in order, but the new entries are sorted once
+  // and merged into ours in a single pass instead of shifting our
+  // storage for every one of them.  Indices may repeat.
+  template <typename I2, typename T2>
+  void insert(const I2* indices, const T2* values, std::size_t n);
+
+  // Streaming insertion: after reserve(), append() entries in any
+  // order, with indices possibly repeated, then finalize() to sort
+  // and combine them.  Nothing but append() and finalize() may be
+  // used in between.
+  void reserve(std::size_t n);
+
+  template <typename T2>
+  void append(index_value_type i, const T2& val);
+
+  void finalize();
+
   bool boolean_test() const;
 
   SubType<T,I> operator- () const;
 
   // Since this is a dynamically allocated sparsity pattern, we can
   // increase it as needed to support e.g. operator+=
-  template <typename I2>
-  void sparsity_union (const std::vector<I2>& new_indices);
+  template <typename Indices2>
+  void sparsity_union (const Indices2& new_indices);
 
   // Since this is a dynamically allocated sparsity pattern, we can
   // decrease it when possible for efficiency
-  template <typename I2>
-  void sparsity_intersection (const std::vector<I2>& new_indices);
+  template <typename Indices2>
+  void sparsity_intersection (const Indices2& new_indices);
 
   // Since this is a dynamically allocated sparsity pattern, we can
   // decrease it when possible for efficiency
   void sparsity_trim ();
 
+  // Drop our entries which are negligible under policy, recording
+  // statistics in it.  Returns the number of entries dropped.
+  std::size_t sparsity_prune (SparsityPruning& policy);
+
+  // Drop our entries with magnitude at most the larger of
+  // absolute_tolerance and relative_tolerance times our largest
+  std::size_t sparsity_prune (double absolute_tolerance,
+                              double relative_tolerance = 0);
+
+  // Store explicit zeros for every missing index between our lowest
+  // and highest, making our sparsity pattern contiguous.
+  // sparsity_trim() undoes this.
+  void sparsity_densify ();
+
+  // Share our sparsity pattern with every other number holding an
+  // interned copy of it.  This does nothing unless
+  // SparsityStorage<I> is shared.
+  void sparsity_intern ();
+
   // Not defineable since !0 != 0
   // SubType<T,I> operator! () const;
 
@@ -168,10 +225,43 @@ public:
   template <typename T2>
   SubType<T,I>& operator/= (const T2& a);
 
+  // Fused in-place update *this = *this * b + a * x, merging the
+  // sparsity pattern of x into ours in a single pass.  No temporaries
+  // are created, and nothing is allocated unless our pattern grows.
+  template <typename TA, typename T2, typename I2, typename TB>
+  SubType<T,I>& axpby (const TA& a, const SubType<T2,I2>& x, const TB& b);
+
+  // Fused in-place update *this = *this / b - x * a / (b * b), the
+  // quotient rule counterpart of axpby.
+  template <typename TA, typename T2, typename I2, typename TB>
+  SubType<T,I>& quotient_update (const TA& a, const SubType<T2,I2>& x, const TB& b);
+
+  // Fused in-place update *this = x / b - *this * a / (b * b), for
+  // quotients whose denominator derivatives we are overwriting.
+  template <typename TA, typename T2, typename I2, typename TB>
+  SubType<T,I>& reverse_quotient_update (const TA& a, const SubType<T2,I2>& x, const TB& b);
+
 protected:
 
+  // Sort our entries from first_unsorted on by index, summing any
+  // with the same index, and merge them with the (sorted, unique)
+  // entries before first_unsorted.
+  void sort_tail(std::size_t first_unsorted);
+
+  // Densify if our fill ratio has reached DensifyThreshold
+  void sparsity_adapt ();
+
+  // Prune under the active SparsityPruning policy, if any
+  void sparsity_prune_active ();
+
+  // Merge the sparsity pattern of x into ours, setting each of our
+  // entries to op(ours, x's), op.self(ours), or op.other(x's)
+  // depending on which operands hold that index.
+  template <typename T2, typename I2, typename Op>
+  void union_apply (const SubType<T2,I2>& x, const Op& op);
+
   std::vector<T> _data;
-  std::vector<I> _indices;
+  typename SparsityStorage<I>::type _indices;
 };
 
 
@@ -217,6 +307,29 @@ DynamicSparseNumberBase_decl_op_ab(opname, subtypename<T MacroComma I>, subtypen
 
 #endif
 
+// Overloads of the DualNumber derivative update hooks, which let
+// DualNumber multiplication and division of dynamically sparse
+// derivatives run in place.
+
+#define DynamicSparseNumberBase_decl_dual_updates(subtypename) \
+template <typename T, typename I, typename TA, typename T2, typename I2, typename TB> \
+inline \
+void \
+dual_product_update (subtypename<T,I>& da, const TA& a, \
+                     const subtypename<T2,I2>& db, const TB& b); \
+ \
+template <typename T, typename I, typename TA, typename T2, typename I2, typename TB> \
+inline \
+void \
+dual_quotient_update (subtypename<T,I>& da, const TA& a, \
+                      const subtypename<T2,I2>& db, const TB& b); \
+ \
+template <typename T, typename I, typename TA, typename T2, typename I2, typename TB> \
+inline \
+void \
+dual_reverse_quotient_update (subtypename<T,I>& db, const TA& a, \
+                              const subtypename<T2,I2>& da, const TB& b);
+
 // Let's also allow scalar times vector.
 // Scalar plus vector, etc. remain undefined in the sparse context.
 
@@ -264,13 +377,13 @@ operator opname (const DynamicSparseNumberBase<T,I,SubType>& a, \
 template <template <typename, typename> class SubType, \
           typename T, typename T2, typename I> \
 inline \
-SubType<bool, I> \
+typename boostcopy::enable_if<BuiltinTraits<T2>, SubType<bool, I> >::type \
 operator opname (const DynamicSparseNumberBase<T,I,SubType>& a, const T2& b); \
  \
 template <template <typename, typename> class SubType, \
           typename T, typename T2, typename I> \
 inline \
-SubType<bool, I> \
+typename boostcopy::enable_if<BuiltinTraits<T>, SubType<bool, I> >::type \
 operator opname (const T& a, const DynamicSparseNumberBase<T2,I,SubType>& b);
 
 // NOTE: unary functions for which 0-op-0 is true are undefined compile-time
@@ -296,6 +409,39 @@ std::ostream&
 operator<< (std::ostream& output, const DynamicSparseNumberBase<T,I,SubType>& a);
 
 
+// Applies f to each entry a stores, in one tight loop.  The caller
+// promises that f(0) == 0, so the result keeps a's sparsity.
+template <template <typename, typename> class SubType,
+          typename T, typename I, typename F>
+inline
+SubType<T, I>
+sparse_apply (const DynamicSparseNumberBase<T,I,SubType>& a, F f);
+
+// Applies f at every index in [first, last), a controlled
+// densification for functions with f(0) != 0.  f(0) is evaluated once
+// for all the indices a doesn't store.  Every index a stores must lie
+// in the range.
+template <template <typename, typename> class SubType,
+          typename T, typename I, typename I2, typename F>
+inline
+SubType<T, I>
+dense_apply (const DynamicSparseNumberBase<T,I,SubType>& a,
+             I2 first, I2 last, F f);
+
+// Applies f at every index in [first, last), reading entries a or b
+// doesn't store as 0, for binary functions with f(0,0) != 0.  Every
+// index either stores must lie in the range.
+template <template <typename, typename> class SubType,
+          typename T, typename T2, typename I, typename I2,
+          typename I3, typename F>
+inline
+SubType<typename SymmetricCompareTypes<T,T2>::supertype,
+        typename CompareTypes<I,I2>::supertype>
+dense_apply (const DynamicSparseNumberBase<T,I,SubType>& a,
+             const DynamicSparseNumberBase<T2,I2,SubType>& b,
+             I3 first, I3 last, F f);
+
+
 // CompareTypes, RawType, ValueType specializations
 
 #define DynamicSparseNumberBase_comparisons(subtypename, templatename) \
@@ -345,14 +491,18 @@ funcname (const DynamicSparseNumberBase<T,I,SubType>& a, \
 template <template <typename, typename> class SubType, \
           typename T, typename T2, typename I> \
 inline \
-SubType<typename SymmetricCompareTypes<T,T2>::supertype, I> \
+SubType<typename SymmetricCompareTypes \
+  <T, typename MetaPhysicL::boostcopy::enable_if \
+        <MetaPhysicL::BuiltinTraits<T2>, T2>::type>::supertype, I> \
 funcname (const DynamicSparseNumberBase<T,I,SubType>& a, const T2& b); \
  \
  \
 template <template <typename, typename> class SubType, \
           typename T, typename T2, typename I> \
 inline \
-SubType<typename SymmetricCompareTypes<T,T2>::supertype, I> \
+SubType<typename SymmetricCompareTypes \
+  <typename MetaPhysicL::boostcopy::enable_if \
+     <MetaPhysicL::BuiltinTraits<T>, T>::type, T2>::supertype, I> \
 funcname (const T& a, const DynamicSparseNumberBase<T2,I,SubType>& b);
 
 
@@ -366,6 +516,10 @@ DynamicSparseNumberBase_decl_std_unary(funcname) \
 DynamicSparseNumberBase_decl_fl_unary(funcname)
 
 
+#define DynamicSparseNumberBase_decl_stdfl_dense_unary(funcname) \
+DynamicSparseNumberBase_decl_stdfl_unary(funcname)
+
+
 #define DynamicSparseNumberBase_decl_fl_binary_union(funcname) \
 DynamicSparseNumberBase_decl_std_binary_union(funcname##f) \
 DynamicSparseNumberBase_decl_std_binary_union(funcname##l)
@@ -375,20 +529,42 @@ DynamicSparseNumberBase_decl_std_binary_union(funcname) \
 DynamicSparseNumberBase_decl_fl_binary_union(funcname)
 
 
+#define DynamicSparseNumberBase_decl_std_minmax_subtype(funcname, subtypename) \
+template <typename T, typename I> \
+inline \
+subtypename<T, I> \
+funcname (const subtypename<T,I>& a, const subtypename<T,I>& b);
+
+#define DynamicSparseNumberBase_decl_std_minmax(subtypename) \
+DynamicSparseNumberBase_decl_std_minmax_subtype(max, subtypename) \
+DynamicSparseNumberBase_decl_std_minmax_subtype(min, subtypename)
+
+
 // Pow needs its own specialization, both to avoid being confused by
 // pow<T1,T2> and because pow(x,0) isn't 0.
-template <template <typename, typename> class SubType, \
+template <template <typename, typename> class SubType,
           typename T, typename T2, typename I>
 inline
-SubType<typename SymmetricCompareTypes<T,T2>::supertype, I>
+SubType<typename SymmetricCompareTypes
+  <T, typename MetaPhysicL::boostcopy::enable_if
+        <MetaPhysicL::BuiltinTraits<T2>, T2>::type>::supertype, I>
 pow (const DynamicSparseNumberBase<T,I,SubType>& a, const T2& b);
 
+template <template <typename, typename> class SubType,
+          typename T, typename T2, typename I, typename I2>
+inline
+SubType<typename SymmetricCompareTypes<T,T2>::supertype,
+        typename CompareTypes<I,I2>::supertype>
+pow (const DynamicSparseNumberBase<T,I,SubType>& a,
+     const DynamicSparseNumberBase<T2,I2,SubType>& b);
 
-// NOTE: unary functions for which f(0) != 0 are undefined compile-time
-// errors, because there's no efficient way to have them make sense in
-// the sparse context.
 
-// DynamicSparseNumberBase_decl_std_binary(pow) // separate definition
+// NOTE: unary functions for which f(0) != 0 are compile-time errors,
+// because there's no efficient way to have them make sense in the
+// sparse context.  MetaPhysicL::dense_apply() evaluates them over an
+// explicit index range instead.
+
+// DynamicSparseNumberBase_decl_std_binary_union(pow) // separate definition
 // DynamicSparseNumberBase_decl_std_unary(exp)
 // DynamicSparseNumberBase_decl_std_unary(log)
 // DynamicSparseNumberBase_decl_std_unary(log10)
@@ -409,35 +585,35 @@ DynamicSparseNumberBase_decl_std_binary_union(max)
 DynamicSparseNumberBase_decl_std_binary_union(min)
 DynamicSparseNumberBase_decl_std_unary(ceil)
 DynamicSparseNumberBase_decl_std_unary(floor)
-DynamicSparseNumberBase_decl_std_binary_union(fmod) // TODO: optimize this
 
 #if __cplusplus >= 201103L
+DynamicSparseNumberBase_decl_stdfl_dense_unary(exp)
+DynamicSparseNumberBase_decl_stdfl_dense_unary(exp2)
+DynamicSparseNumberBase_decl_stdfl_dense_unary(log)
+DynamicSparseNumberBase_decl_stdfl_dense_unary(log10)
+DynamicSparseNumberBase_decl_stdfl_dense_unary(log2)
+DynamicSparseNumberBase_decl_stdfl_dense_unary(cos)
+DynamicSparseNumberBase_decl_stdfl_dense_unary(acos)
+DynamicSparseNumberBase_decl_stdfl_dense_unary(cosh)
+DynamicSparseNumberBase_decl_stdfl_dense_unary(acosh)
+DynamicSparseNumberBase_decl_stdfl_dense_unary(erfc)
+
 DynamicSparseNumberBase_decl_std_unary(llabs)
 DynamicSparseNumberBase_decl_std_unary(imaxabs)
 DynamicSparseNumberBase_decl_fl_unary(fabs)
-// DynamicSparseNumberBase_decl_fl_unary(exp)
-// DynamicSparseNumberBase_decl_stdfl_unary(exp2)
 DynamicSparseNumberBase_decl_stdfl_unary(expm1)
-// DynamicSparseNumberBase_decl_fl_unary(log)
-// DynamicSparseNumberBase_decl_fl_unary(log10)
-// DynamicSparseNumberBase_decl_stdfl_unary(log2)
-// DynamicSparseNumberBase_decl_stdfl_unary(log1p)
+DynamicSparseNumberBase_decl_stdfl_unary(log1p)
 DynamicSparseNumberBase_decl_fl_unary(sqrt)
 DynamicSparseNumberBase_decl_stdfl_unary(cbrt)
 DynamicSparseNumberBase_decl_fl_unary(sin)
-// DynamicSparseNumberBase_decl_fl_unary(cos)
 DynamicSparseNumberBase_decl_fl_unary(tan)
 DynamicSparseNumberBase_decl_fl_unary(asin)
-// DynamicSparseNumberBase_decl_fl_unary(acos)
 DynamicSparseNumberBase_decl_fl_unary(atan)
 DynamicSparseNumberBase_decl_fl_unary(sinh)
-// DynamicSparseNumberBase_decl_fl_unary(cosh)
 DynamicSparseNumberBase_decl_fl_unary(tanh)
 DynamicSparseNumberBase_decl_stdfl_unary(asinh)
-// DynamicSparseNumberBase_decl_stdfl_unary(acosh)
 DynamicSparseNumberBase_decl_stdfl_unary(atanh)
 DynamicSparseNumberBase_decl_stdfl_unary(erf)
-// DynamicSparseNumberBase_decl_stdfl_unary(erfc)
 DynamicSparseNumberBase_decl_fl_unary(ceil)
 DynamicSparseNumberBase_decl_fl_unary(floor)
 DynamicSparseNumberBase_decl_stdfl_unary(trunc)
@@ -445,8 +621,8 @@ DynamicSparseNumberBase_decl_stdfl_unary(round)
 DynamicSparseNumberBase_decl_stdfl_unary(nearbyint)
 DynamicSparseNumberBase_decl_stdfl_unary(rint)
 
-DynamicSparseNumberBase_decl_fl_binary_union(fmod)
-DynamicSparseNumberBase_decl_std_binary_union(remainder) // TODO: optimize this
+DynamicSparseNumberBase_decl_stdfl_binary_union(fmod)
+DynamicSparseNumberBase_decl_stdfl_binary_union(remainder)
 DynamicSparseNumberBase_decl_stdfl_binary_union(fmax)
 DynamicSparseNumberBase_decl_stdfl_binary_union(fmin)
 DynamicSparseNumberBase_decl_stdfl_binary_union(fdim)
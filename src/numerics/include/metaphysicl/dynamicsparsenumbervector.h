@@ -72,24 +72,14 @@ template <typename T2, typename I2>
 typename MultipliesType<T,T2>::supertype
 DynamicSparseNumberVector<T,I>::dot (const DynamicSparseNumberVector<T2,I2>& a) const
 {
-  typename MultipliesType<T,T2>::supertype returnval = 0;
+  SparseDotFunctor<T, T2, typename MultipliesType<T,T2>::supertype>
+    dotter(this->_data, a.nude_data());
 
-  for (I i1 = 0; i1 != this->_indices.size(); ++i1)
-    {
-      typename std::vector<I2>::const_iterator it2 =
-        std::lower_bound(a.nude_indices().begin(),
-                         a.nude_indices().end(),
-                         this->_indices[i1]);
-
-      if (it2 != a.nude_indices().end())
-        {
-          std::size_t i2 = it2 - a.nude_indices().begin();
+  SortedSet::for_each_common(this->_indices.begin(), this->_indices.end(),
+                             a.nude_indices().begin(), a.nude_indices().end(),
+                             dotter);
 
-          returnval += this->_data[i1] * a.raw_at(i2);
-        }
-    }
-
-  return returnval;
+  return dotter.sum;
 }
 
 template <typename T, typename I>
@@ -178,6 +168,8 @@ DynamicSparseNumberBase_op(DynamicSparseNumberVector, -, Minus)      // Union)
 DynamicSparseNumberBase_op(DynamicSparseNumberVector, *, Multiplies) // Intersection)
 DynamicSparseNumberBase_op(DynamicSparseNumberVector, /, Divides)    // First)
 
+DynamicSparseNumberBase_dual_updates(DynamicSparseNumberVector)
+
 
 template <typename T, typename I>
 inline
@@ -198,4 +190,11 @@ RawType<DynamicSparseNumberVector<T, I> >::value(const DynamicSparseNumberVector
 } // namespace MetaPhysicL
 
 
+namespace std {
+
+DynamicSparseNumberBase_std_minmax(DynamicSparseNumberVector)
+
+} // namespace std
+
+
 #endif // METAPHYSICL_DYNAMICSPARSENUMBERVECTOR_H
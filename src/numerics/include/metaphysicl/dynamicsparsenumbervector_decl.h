@@ -198,6 +198,8 @@ DynamicSparseNumberBase_decl_op(DynamicSparseNumberVector, -, Minus)      // Uni
 DynamicSparseNumberBase_decl_op(DynamicSparseNumberVector, *, Multiplies) // Intersection)
 DynamicSparseNumberBase_decl_op(DynamicSparseNumberVector, /, Divides)    // First)
 
+DynamicSparseNumberBase_decl_dual_updates(DynamicSparseNumberVector)
+
 
 // CompareTypes, RawType, ValueType specializations
 
@@ -235,6 +237,8 @@ template <typename T, typename I>
 class numeric_limits<DynamicSparseNumberVector<T, I> > :
   public MetaPhysicL::raw_numeric_limits<DynamicSparseNumberVector<T, I>, T> {};
 
+DynamicSparseNumberBase_decl_std_minmax(DynamicSparseNumberVector)
+
 } // namespace std
 
 
@@ -0,0 +1,471 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// MetaPhysicL - A metaprogramming library for physics calculations
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+//
+// $Id$
+//
+//--------------------------------------------------------------------------
+
+#ifndef METAPHYSICL_HASHEDSPARSENUMBERARRAY_H
+#define METAPHYSICL_HASHEDSPARSENUMBERARRAY_H
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <ostream>
+#include <vector>
+
+#include <stdint.h>
+
+#include "metaphysicl/compare_types.h"
+#include "metaphysicl/dynamicsparsenumberarray.h"
+#include "metaphysicl/metaphysicl_asserts.h"
+
+namespace MetaPhysicL {
+
+// A sparse array for very wide index spaces accessed in no
+// particular order, such as derivatives with respect to millions of
+// parameters.  DynamicSparseNumberArray keeps its indices sorted, so
+// inserting or looking up an index in a large one takes time linear
+// or logarithmic in its size; here both take expected constant time.
+//
+// Entries are stored densely in insertion order, and located through
+// an open addressing hash table of their positions.  raw_index(k)
+// and raw_at(k) walk them in that order.  Arithmetic which merges
+// patterns entry by entry belongs on the sorted form: sorted() and
+// the converting constructor switch between the two.
+
+template <typename T, typename I>
+class HashedSparseNumberArray
+{
+public:
+  typedef T value_type;
+
+  typedef I index_value_type;
+
+  HashedSparseNumberArray() : _shift(0) {}
+
+  template <typename T2, typename I2>
+  explicit HashedSparseNumberArray(const DynamicSparseNumberArray<T2, I2>& src);
+
+  std::size_t size() const { return _indices.size(); }
+
+  // Make room for n entries without rehashing
+  void reserve(std::size_t n);
+
+  void clear();
+
+  I raw_index(std::size_t k) const { return _indices[k]; }
+
+  T& raw_at(std::size_t k) { return _data[k]; }
+
+  const T& raw_at(std::size_t k) const { return _data[k]; }
+
+  const std::vector<I>& nude_indices() const { return _indices; }
+
+  const std::vector<T>& nude_data() const { return _data; }
+
+  std::vector<T>& nude_data() { return _data; }
+
+  // The position of index i in raw order, or the maximum size_t if
+  // we have no entry for i
+  std::size_t runtime_index_query(index_value_type i) const;
+
+  T& operator[](index_value_type i);
+
+  const T& operator[](index_value_type i) const;
+
+  // Our entry for index i, created as zero if we had none
+  value_type& insert(index_value_type i);
+
+  // Drop entries which are exactly zero
+  void sparsity_trim ();
+
+  // Our entries, sorted by index
+  DynamicSparseNumberArray<T, I> sorted() const;
+
+  HashedSparseNumberArray<T,I> operator- () const;
+
+  template <typename T2, typename I2>
+  HashedSparseNumberArray<T,I>& operator+= (const HashedSparseNumberArray<T2,I2>& a);
+
+  template <typename T2, typename I2>
+  HashedSparseNumberArray<T,I>& operator+= (const DynamicSparseNumberArray<T2,I2>& a);
+
+  template <typename T2, typename I2>
+  HashedSparseNumberArray<T,I>& operator-= (const HashedSparseNumberArray<T2,I2>& a);
+
+  template <typename T2, typename I2>
+  HashedSparseNumberArray<T,I>& operator-= (const DynamicSparseNumberArray<T2,I2>& a);
+
+  template <typename T2>
+  typename boostcopy::enable_if<BuiltinTraits<T2>, HashedSparseNumberArray<T,I>&>::type
+  operator*= (const T2& a);
+
+  template <typename T2>
+  typename boostcopy::enable_if<BuiltinTraits<T2>, HashedSparseNumberArray<T,I>&>::type
+  operator/= (const T2& a);
+
+private:
+  // Fibonacci hashing: the high bits of a multiplicative hash
+  std::size_t hash_slot (I i) const
+    { return std::size_t((uint64_t(i) * 0x9E3779B97F4A7C15ull) >> _shift); }
+
+  // The slot holding index i, or the empty slot where it would go
+  std::size_t find_slot (I i) const;
+
+  // Rebuild the table with n_slots slots, a power of two
+  void rehash (std::size_t n_slots);
+
+  // Table slots hold one more than the position of their entry, or 0
+  // if empty; tables are at most this full
+  static const std::size_t max_load_percent = 70;
+
+  std::vector<I> _indices;
+  std::vector<T> _data;
+  std::vector<std::size_t> _slots;
+  unsigned int _shift;
+};
+
+
+//
+// Non-member functions
+//
+
+template <typename T, typename I, typename T2, typename I2>
+inline
+HashedSparseNumberArray<typename CompareTypes<T,T2>::supertype,
+                        typename CompareTypes<I,I2>::supertype>
+operator+ (const HashedSparseNumberArray<T,I>& a,
+           const HashedSparseNumberArray<T2,I2>& b)
+{
+  HashedSparseNumberArray<typename CompareTypes<T,T2>::supertype,
+                          typename CompareTypes<I,I2>::supertype> returnval;
+  returnval.reserve(a.size());
+  returnval += a;
+  returnval += b;
+  return returnval;
+}
+
+template <typename T, typename I, typename T2, typename I2>
+inline
+HashedSparseNumberArray<typename CompareTypes<T,T2>::supertype,
+                        typename CompareTypes<I,I2>::supertype>
+operator- (const HashedSparseNumberArray<T,I>& a,
+           const HashedSparseNumberArray<T2,I2>& b)
+{
+  HashedSparseNumberArray<typename CompareTypes<T,T2>::supertype,
+                          typename CompareTypes<I,I2>::supertype> returnval;
+  returnval.reserve(a.size());
+  returnval += a;
+  returnval -= b;
+  return returnval;
+}
+
+template <typename T, typename I, typename T2>
+inline
+typename boostcopy::enable_if
+  <BuiltinTraits<T2>,
+   HashedSparseNumberArray<typename CompareTypes<T,T2>::supertype, I> >::type
+operator* (const HashedSparseNumberArray<T,I>& a, const T2& b)
+{
+  HashedSparseNumberArray<typename CompareTypes<T,T2>::supertype, I> returnval;
+  returnval.reserve(a.size());
+  returnval += a;
+  returnval *= b;
+  return returnval;
+}
+
+template <typename T, typename I, typename T2>
+inline
+typename boostcopy::enable_if
+  <BuiltinTraits<T2>,
+   HashedSparseNumberArray<typename CompareTypes<T,T2>::supertype, I> >::type
+operator* (const T2& a, const HashedSparseNumberArray<T,I>& b)
+{
+  return b * a;
+}
+
+template <typename T, typename I, typename T2>
+inline
+typename boostcopy::enable_if
+  <BuiltinTraits<T2>,
+   HashedSparseNumberArray<typename CompareTypes<T,T2>::supertype, I> >::type
+operator/ (const HashedSparseNumberArray<T,I>& a, const T2& b)
+{
+  HashedSparseNumberArray<typename CompareTypes<T,T2>::supertype, I> returnval;
+  returnval.reserve(a.size());
+  returnval += a;
+  returnval /= b;
+  return returnval;
+}
+
+template <typename T, typename I>
+inline
+std::ostream&
+operator<< (std::ostream& output, const HashedSparseNumberArray<T, I>& a)
+{
+  return output << a.sorted();
+}
+
+
+//
+// Member definitions
+//
+
+template <typename T, typename I>
+template <typename T2, typename I2>
+inline
+HashedSparseNumberArray<T,I>::HashedSparseNumberArray
+  (const DynamicSparseNumberArray<T2, I2>& src) :
+  _shift(0)
+{
+  this->reserve(src.size());
+  *this += src;
+}
+
+template <typename T, typename I>
+inline
+void
+HashedSparseNumberArray<T,I>::reserve(std::size_t n)
+{
+  _indices.reserve(n);
+  _data.reserve(n);
+
+  std::size_t n_slots = _slots.empty() ? 16 : _slots.size();
+  while (n * 100 > n_slots * max_load_percent)
+    n_slots *= 2;
+  if (n_slots != _slots.size())
+    this->rehash(n_slots);
+}
+
+template <typename T, typename I>
+inline
+void
+HashedSparseNumberArray<T,I>::clear()
+{
+  _indices.clear();
+  _data.clear();
+  _slots.clear();
+  _shift = 0;
+}
+
+template <typename T, typename I>
+inline
+std::size_t
+HashedSparseNumberArray<T,I>::find_slot(I i) const
+{
+  const std::size_t mask = _slots.size() - 1;
+  std::size_t slot = this->hash_slot(i);
+  for (std::size_t p = _slots[slot]; p && _indices[p-1] != i;
+       p = _slots[slot])
+    slot = (slot + 1) & mask;
+  return slot;
+}
+
+template <typename T, typename I>
+inline
+void
+HashedSparseNumberArray<T,I>::rehash(std::size_t n_slots)
+{
+  _slots.assign(n_slots, 0);
+  _shift = 64;
+  for (std::size_t n = n_slots; n > 1; n /= 2)
+    --_shift;
+
+  for (std::size_t k = 0; k != _indices.size(); ++k)
+    _slots[this->find_slot(_indices[k])] = k + 1;
+}
+
+template <typename T, typename I>
+inline
+std::size_t
+HashedSparseNumberArray<T,I>::runtime_index_query(index_value_type i) const
+{
+  if (_slots.empty())
+    return std::numeric_limits<std::size_t>::max();
+  const std::size_t p = _slots[this->find_slot(i)];
+  return p ? p - 1 : std::numeric_limits<std::size_t>::max();
+}
+
+template <typename T, typename I>
+inline
+T&
+HashedSparseNumberArray<T,I>::operator[](index_value_type i)
+{
+  static T zero = 0;
+
+  // Bad user code could make this fail.  We'd prefer to catch OOB
+  // writes at *write* time but at least we can catch at read time.
+  metaphysicl_assert(zero == T(0));
+
+  std::size_t rq = runtime_index_query(i);
+  if (rq == std::numeric_limits<std::size_t>::max())
+    return zero;
+  return _data[rq];
+}
+
+template <typename T, typename I>
+inline
+const T&
+HashedSparseNumberArray<T,I>::operator[](index_value_type i) const
+{
+  static const T zero = 0;
+  std::size_t rq = runtime_index_query(i);
+  if (rq == std::numeric_limits<std::size_t>::max())
+    return zero;
+  return _data[rq];
+}
+
+template <typename T, typename I>
+inline
+T&
+HashedSparseNumberArray<T,I>::insert(index_value_type i)
+{
+  if ((this->size() + 1) * 100 > _slots.size() * max_load_percent)
+    this->reserve(std::max(2 * this->size(), std::size_t(8)));
+
+  const std::size_t slot = this->find_slot(i);
+  if (!_slots[slot])
+    {
+      _indices.push_back(i);
+      _data.push_back(T(0));
+      _slots[slot] = _indices.size();
+    }
+  return _data[_slots[slot] - 1];
+}
+
+template <typename T, typename I>
+inline
+void
+HashedSparseNumberArray<T,I>::sparsity_trim()
+{
+  std::size_t n_kept = 0;
+  for (std::size_t k = 0; k != _data.size(); ++k)
+    if (_data[k])
+      {
+        _indices[n_kept] = _indices[k];
+        _data[n_kept] = _data[k];
+        ++n_kept;
+      }
+
+  if (n_kept == _data.size())
+    return;
+
+  _indices.resize(n_kept);
+  _data.resize(n_kept);
+  this->rehash(_slots.size());
+}
+
+template <typename T, typename I>
+inline
+DynamicSparseNumberArray<T, I>
+HashedSparseNumberArray<T,I>::sorted() const
+{
+  DynamicSparseNumberArray<T, I> returnval;
+  returnval.reserve(this->size());
+  for (std::size_t k = 0; k != this->size(); ++k)
+    returnval.append(_indices[k], _data[k]);
+  returnval.finalize();
+  return returnval;
+}
+
+template <typename T, typename I>
+inline
+HashedSparseNumberArray<T,I>
+HashedSparseNumberArray<T,I>::operator- () const
+{
+  HashedSparseNumberArray<T,I> returnval = *this;
+  for (std::size_t k = 0; k != returnval.size(); ++k)
+    returnval._data[k] = -returnval._data[k];
+  return returnval;
+}
+
+template <typename T, typename I>
+template <typename T2, typename I2>
+inline
+HashedSparseNumberArray<T,I>&
+HashedSparseNumberArray<T,I>::operator+= (const HashedSparseNumberArray<T2,I2>& a)
+{
+  for (std::size_t k = 0; k != a.size(); ++k)
+    this->insert(a.raw_index(k)) += a.raw_at(k);
+  return *this;
+}
+
+template <typename T, typename I>
+template <typename T2, typename I2>
+inline
+HashedSparseNumberArray<T,I>&
+HashedSparseNumberArray<T,I>::operator+= (const DynamicSparseNumberArray<T2,I2>& a)
+{
+  for (std::size_t k = 0; k != a.size(); ++k)
+    this->insert(a.raw_index(k)) += a.raw_at(k);
+  return *this;
+}
+
+template <typename T, typename I>
+template <typename T2, typename I2>
+inline
+HashedSparseNumberArray<T,I>&
+HashedSparseNumberArray<T,I>::operator-= (const HashedSparseNumberArray<T2,I2>& a)
+{
+  for (std::size_t k = 0; k != a.size(); ++k)
+    this->insert(a.raw_index(k)) -= a.raw_at(k);
+  return *this;
+}
+
+template <typename T, typename I>
+template <typename T2, typename I2>
+inline
+HashedSparseNumberArray<T,I>&
+HashedSparseNumberArray<T,I>::operator-= (const DynamicSparseNumberArray<T2,I2>& a)
+{
+  for (std::size_t k = 0; k != a.size(); ++k)
+    this->insert(a.raw_index(k)) -= a.raw_at(k);
+  return *this;
+}
+
+template <typename T, typename I>
+template <typename T2>
+inline
+typename boostcopy::enable_if<BuiltinTraits<T2>, HashedSparseNumberArray<T,I>&>::type
+HashedSparseNumberArray<T,I>::operator*= (const T2& a)
+{
+  for (std::size_t k = 0; k != _data.size(); ++k)
+    _data[k] *= a;
+  return *this;
+}
+
+template <typename T, typename I>
+template <typename T2>
+inline
+typename boostcopy::enable_if<BuiltinTraits<T2>, HashedSparseNumberArray<T,I>&>::type
+HashedSparseNumberArray<T,I>::operator/= (const T2& a)
+{
+  for (std::size_t k = 0; k != _data.size(); ++k)
+    _data[k] /= a;
+  return *this;
+}
+
+} // namespace MetaPhysicL
+
+#endif // METAPHYSICL_HASHEDSPARSENUMBERARRAY_H
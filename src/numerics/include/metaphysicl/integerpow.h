@@ -0,0 +1,296 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// MetaPhysicL - A metaprogramming library for physics calculations
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+//
+// $Id$
+//
+//--------------------------------------------------------------------------
+
+
+#ifndef METAPHYSICL_INTEGERPOW_H
+#define METAPHYSICL_INTEGERPOW_H
+
+#include <cmath>
+#include <limits>
+
+#include "metaphysicl/compare_types.h"
+
+namespace MetaPhysicL {
+
+// pow(x, b) for integer and half-integer exponents b, with |b| no
+// larger than max_fast_pow_exponent, is evaluated by repeated
+// squaring (and one sqrt) rather than by libm's exp(b log(x)).  Values
+// may differ from std::pow by a few ulps at the largest exponents.
+// Zero, infinite and NaN bases, and bases large or small enough for
+// a partial product to leave the normal range, go to std::pow, which
+// gets their signs, infinities and subnormal results right.
+static const int max_fast_pow_exponent = 32;
+
+// FastPowTraits<T>::value is true for the real floating point types
+// which pow evaluates by squaring; integer results keep std::pow's
+// conversions, and other types of x keep their own pow.
+template <typename T>
+struct FastPowTraits
+{
+  static const bool value = BuiltinTraits<T>::value &&
+                            std::numeric_limits<T>::is_specialized &&
+                            !std::numeric_limits<T>::is_integer;
+};
+
+
+template <typename T,
+          bool is_real = BuiltinTraits<T>::value &&
+                         std::numeric_limits<T>::is_specialized,
+          bool is_integer = std::numeric_limits<T>::is_integer>
+struct FastPowExponent
+{
+  // Complex and non-builtin exponents always go to std::pow
+  static bool twice (const T &, int &) { return false; }
+};
+
+// Integral exponents are known at compile time to be integers
+template <typename T>
+struct FastPowExponent<T, true, true>
+{
+  static bool twice (const T & b, int & twice_b)
+  {
+    if (b > T(max_fast_pow_exponent) ||
+        (std::numeric_limits<T>::is_signed &&
+         b < T(-max_fast_pow_exponent)))
+      return false;
+    twice_b = 2 * static_cast<int>(b);
+    return true;
+  }
+};
+
+template <typename T>
+struct FastPowExponent<T, true, false>
+{
+  static bool twice (const T & b, int & twice_b)
+  {
+    const T twice_t = 2 * b;
+    // Written to fail for NaN
+    if (!(twice_t <= T(2 * max_fast_pow_exponent) &&
+          twice_t >= T(-2 * max_fast_pow_exponent)))
+      return false;
+    twice_b = static_cast<int>(twice_t);
+    return T(twice_b) == twice_t;
+  }
+};
+
+
+// Returns true, setting twice_b = 2b, if b is an exponent which pow
+// can evaluate by squaring
+template <typename T>
+inline
+bool
+fast_pow_exponent (const T & b, int & twice_b)
+{
+  return FastPowExponent<T>::twice(b, twice_b);
+}
+
+
+// Returns true if x is a base which pow can raise to the power b,
+// where twice_b = 2b, by squaring: every partial product and the
+// result must be normal and finite.  Types whose values hold several
+// numbers overload this instead, to be found by argument dependent
+// lookup.
+template <typename T>
+inline
+bool
+fast_pow_base (const T & x, int twice_b)
+{
+  // Written to fail for NaN
+  const T abs_x = x < 0 ? -x : x;
+  if (!(abs_x >= std::numeric_limits<T>::min() &&
+        abs_x <= std::numeric_limits<T>::max()))
+    return false;
+
+  // |x| is within a factor of 2 of 2^e, so its powers up to n+1 stay
+  // within 2^((|e|+1)(n+1)) of 1
+  int e;
+  std::frexp(abs_x, &e);
+  const int n = (twice_b < 0 ? -twice_b : twice_b) / 2;
+  return ((e < 0 ? -e : e) + 1) * (n + 1) <=
+         -std::numeric_limits<T>::min_exponent - 2;
+}
+
+
+// The square root for half-integer exponents.  Types whose std::sqrt
+// may be declared after this header overload this instead, to be
+// found by argument dependent lookup.
+template <typename T>
+inline
+T
+fast_pow_sqrt (const T & x)
+{
+  return std::sqrt(x);
+}
+
+
+// x^n for n >= 0
+template <typename T>
+inline
+T
+integer_pow (T x, unsigned int n)
+{
+  T returnval = 1;
+  while (true)
+    {
+      if (n & 1)
+        returnval *= x;
+      n >>= 1;
+      if (!n)
+        return returnval;
+      x *= x;
+    }
+}
+
+
+// x^b, where twice_b = 2b, and its derivative b x^(b-1).  Negative
+// exponents take a single division, at the end.  Callers check
+// fast_pow_base(x, twice_b) first.
+template <typename T>
+inline
+T
+fast_pow (const T & x, int twice_b, T & dfdx)
+{
+  const T b = T(twice_b) / 2;
+  const bool half = twice_b % 2;
+  const unsigned int n = (twice_b < 0 ? -twice_b : twice_b) / 2;
+
+  if (twice_b > 0)
+    {
+      // x^b = x^(n-1) x [sqrt(x)] for integer [half-integer] b
+      if (half)
+        {
+          const T root = fast_pow_sqrt(x);
+          if (!n)
+            {
+              dfdx = b / root;
+              return root;
+            }
+          const T p = integer_pow(x, n - 1) * root;
+          dfdx = b * p;
+          return p * x;
+        }
+      const T p = integer_pow(x, n - 1);
+      dfdx = b * p;
+      return p * x;
+    }
+
+  if (!twice_b)
+    {
+      dfdx = 0;
+      return 1;
+    }
+
+  // x^b = 1 / (x^n [sqrt(x)])
+  T q = integer_pow(x, n);
+  if (half)
+    q *= fast_pow_sqrt(x);
+  const T returnval = 1 / q;
+  dfdx = b / (q * x);
+  return returnval;
+}
+
+
+// x^b alone, where twice_b = 2b
+template <typename T>
+inline
+T
+fast_pow (const T & x, int twice_b)
+{
+  const unsigned int n = (twice_b < 0 ? -twice_b : twice_b) / 2;
+  T returnval = integer_pow(x, n);
+  if (twice_b % 2)
+    returnval *= fast_pow_sqrt(x);
+  return (twice_b < 0) ? 1 / returnval : returnval;
+}
+
+
+// Sets f = x^b and dfdx = b x^(b-1) and returns true if b and x are
+// in range for evaluating x^b by squaring; otherwise returns false,
+// and the caller uses std::pow.  Types which FastPowTraits excludes
+// always return false, without instantiating fast_pow.
+template <typename T, typename T2>
+inline
+typename boostcopy::enable_if_c<FastPowTraits<T>::value, bool>::type
+try_fast_pow (const T & x, const T2 & b, T & f, T & dfdx)
+{
+  int twice_b = 0;
+  if (!fast_pow_exponent(b, twice_b) || !fast_pow_base(x, twice_b))
+    return false;
+  f = fast_pow(x, twice_b, dfdx);
+  return true;
+}
+
+template <typename T, typename T2>
+inline
+typename boostcopy::enable_if_c<!FastPowTraits<T>::value, bool>::type
+try_fast_pow (const T &, const T2 &, T &, T &)
+{
+  return false;
+}
+
+
+// std::pow(x, b) with b fixed, for containers to apply to each of
+// their entries after classifying b once
+template <typename T2>
+class FixedExponentPow
+{
+public:
+  explicit FixedExponentPow (const T2 & b) :
+    _b(b), _twice_b(0), _fast(fast_pow_exponent(b, _twice_b)) {}
+
+  template <typename T>
+  typename boostcopy::enable_if_c
+    <FastPowTraits<typename SymmetricCompareTypes<T,T2>::supertype>::value,
+     typename SymmetricCompareTypes<T,T2>::supertype>::type
+  operator() (const T & x) const
+  {
+    typedef typename SymmetricCompareTypes<T,T2>::supertype TS;
+    const TS xs = x;
+    if (_fast && fast_pow_base(xs, _twice_b))
+      return fast_pow(xs, _twice_b);
+    return std::pow(xs, TS(_b));
+  }
+
+  template <typename T>
+  typename boostcopy::enable_if_c
+    <!FastPowTraits<typename SymmetricCompareTypes<T,T2>::supertype>::value,
+     typename SymmetricCompareTypes<T,T2>::supertype>::type
+  operator() (const T & x) const
+  {
+    return std::pow(x, _b);
+  }
+
+private:
+  const T2 _b;
+  int _twice_b;
+  const bool _fast;
+};
+
+} // namespace MetaPhysicL
+
+
+#endif // METAPHYSICL_INTEGERPOW_H
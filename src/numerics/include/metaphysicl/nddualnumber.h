@@ -28,6 +28,8 @@ public:
 template <typename T, typename D>
 using NDDualNumber = NotADuckDualNumber<T, D>;
 
+// The rvalue DualNumber overloads keep DualNumber move operators from
+// being preferred over (and losing the NotADuck type of) these.
 #define NDDualNumber_op(opname, functorname, dn_first_calc, dn_second_calc, dualcalc)              \
   template <typename T, typename D, typename T2, typename D2>                                      \
   inline auto operator opname(const NDDualNumber<T, D> & a, const NDDualNumber<T2, D2> & b)        \
@@ -56,6 +58,24 @@ using NDDualNumber = NotADuckDualNumber<T, D>;
     return {value, derivatives};                                                                   \
   }                                                                                                \
                                                                                                    \
+  template <typename T, typename D, typename T2, typename D2>                                      \
+  inline auto operator opname(const NDDualNumber<T, D> & a, DualNumber<T2, D2> && b)               \
+      ->NDDualNumber<decltype(a.value() opname b.value()), decltype(dualcalc)>                     \
+  {                                                                                                \
+    auto value = a.value() opname b.value();                                                       \
+    auto derivatives = dualcalc;                                                                   \
+    return {value, derivatives};                                                                   \
+  }                                                                                                \
+                                                                                                   \
+  template <typename T, typename D, typename T2, typename D2>                                      \
+  inline auto operator opname(DualNumber<T, D> && a, const NDDualNumber<T2, D2> & b)               \
+      ->NDDualNumber<decltype(a.value() opname b.value()), decltype(dualcalc)>                     \
+  {                                                                                                \
+    auto value = a.value() opname b.value();                                                       \
+    auto derivatives = dualcalc;                                                                   \
+    return {value, derivatives};                                                                   \
+  }                                                                                                \
+                                                                                                   \
   template <typename T, typename T2, typename D>                                                   \
   inline auto operator opname(const T & a, const NDDualNumber<T2, D> & b)                          \
       ->NDDualNumber<decltype(a opname b.value()), decltype(dn_second_calc)>                       \
@@ -34,7 +34,10 @@
 
 #include "metaphysicl/compare_types.h"
 #include "metaphysicl/ct_types.h"
+#include "metaphysicl/integerpow.h"
+#include "metaphysicl/metaprogramming.h" // for Unroll
 #include "metaphysicl/raw_type.h"
+#include "metaphysicl/simdmath.h"
 
 namespace MetaPhysicL {
 
@@ -58,6 +61,11 @@ struct SumType<NumberArray<N,S> > {
   typedef NumberArray<N, typename SumType<S>::supertype> supertype;
 };
 
+template <std::size_t N, typename T>
+struct DenseTraits<NumberArray<N,T> > {
+  static const bool value = true;
+};
+
 template <std::size_t N, typename T>
 class NumberArray
 {
@@ -133,55 +141,54 @@ public:
 
   NumberArray<N,T> operator- () const {
     NumberArray<N,T> returnval;
-    for (std::size_t i=0; i != N; ++i) returnval[i] = -_data[i];
+    Unroll<N>::apply([&](std::size_t i){ returnval[i] = -_data[i]; });
     return returnval;
   }
 
   NumberArray<N,T> operator! () const {
     NumberArray<N,T> returnval;
-    for (std::size_t i=0; i != N; ++i) returnval[i] = !_data[i];
+    Unroll<N>::apply([&](std::size_t i){ returnval[i] = !_data[i]; });
     return returnval;
   }
 
   template <typename T2>
   NumberArray<N,T>& operator+= (const NumberArray<N,T2>& a)
-    { for (std::size_t i=0; i != N; ++i) _data[i] += a[i]; return *this; }
+    { Unroll<N>::apply([&](std::size_t i){ _data[i] += a[i]; }); return *this; }
 
   template <typename T2>
   NumberArray<N,T>& operator+= (const T2& a)
-    { for (std::size_t i=0; i != N; ++i) _data[i] += a; return *this; }
+    { Unroll<N>::apply([&](std::size_t i){ _data[i] += a; }); return *this; }
 
   template <typename T2>
   NumberArray<N,T>& operator-= (const NumberArray<N,T2>& a)
-    { for (std::size_t i=0; i != N; ++i) _data[i] -= a[i]; return *this; }
+    { Unroll<N>::apply([&](std::size_t i){ _data[i] -= a[i]; }); return *this; }
 
   template <typename T2>
   NumberArray<N,T>& operator-= (const T2& a)
-    { for (std::size_t i=0; i != N; ++i) _data[i] -= a; return *this; }
+    { Unroll<N>::apply([&](std::size_t i){ _data[i] -= a; }); return *this; }
 
   template <typename T2>
   NumberArray<N,T>& operator*= (const NumberArray<N,T2>& a)
-    { for (std::size_t i=0; i != N; ++i) _data[i] *= a[i]; return *this; }
+    { Unroll<N>::apply([&](std::size_t i){ _data[i] *= a[i]; }); return *this; }
 
   template <typename T2>
   NumberArray<N,T>& operator*= (const T2& a)
-    { for (std::size_t i=0; i != N; ++i) _data[i] *= a; return *this; }
+    { Unroll<N>::apply([&](std::size_t i){ _data[i] *= a; }); return *this; }
 
   template <typename T2>
   NumberArray<N,T>& operator/= (const NumberArray<N,T2>& a)
-    { for (std::size_t i=0; i != N; ++i) _data[i] /= a[i]; return *this; }
+    { Unroll<N>::apply([&](std::size_t i){ _data[i] /= a[i]; }); return *this; }
 
   template <typename T2>
   NumberArray<N,T>& operator/= (const T2& a)
-    { for (std::size_t i=0; i != N; ++i) _data[i] /= a; return *this; }
+    { Unroll<N>::apply([&](std::size_t i){ _data[i] /= a; }); return *this; }
 
   template <typename T2>
   NumberArray<N, typename DotType<T,T2>::supertype>
   dot (const NumberArray<N,T2>& a) const
   {
     NumberArray<N, typename DotType<T,T2>::supertype> returnval;
-    for (std::size_t i=0; i != N; ++i)
-      returnval[i] = _data[i].dot(a[i]);
+    Unroll<N>::apply([&](std::size_t i){ returnval[i] = _data[i].dot(a[i]); });
     return returnval;
   }
 
@@ -192,12 +199,44 @@ public:
     typename OuterProductType<NumberArray<N,T>,NumberArray<N,T2> >::supertype
       returnval;
 
-    for (std::size_t i=0; i != N; ++i)
-      returnval[i] = _data[i].outerproduct(a[i]);
+    Unroll<N>::apply([&](std::size_t i)
+      { returnval[i] = _data[i].outerproduct(a[i]); });
 
     return returnval;
   }
 
+  // Fused in-place update *this = *this * b + a * x, the DualNumber
+  // product rule, without temporaries.
+  template <typename TA, typename T2, typename TB>
+  NumberArray<N,T>&
+  axpby (const TA& a, const NumberArray<N,T2>& x, const TB& b)
+    {
+      Unroll<N>::apply([&](std::size_t i){ _data[i] = _data[i] * b + a * x[i]; });
+      return *this;
+    }
+
+  // Fused in-place update *this = *this / b - x * a / (b * b), the
+  // quotient rule counterpart of axpby.
+  template <typename TA, typename T2, typename TB>
+  NumberArray<N,T>&
+  quotient_update (const TA& a, const NumberArray<N,T2>& x, const TB& b)
+    {
+      Unroll<N>::apply([&](std::size_t i)
+        { _data[i] = _data[i] / b - x[i] * a / (b * b); });
+      return *this;
+    }
+
+  // Fused in-place update *this = x / b - *this * a / (b * b), for
+  // quotients whose denominator derivatives we are overwriting.
+  template <typename TA, typename T2, typename TB>
+  NumberArray<N,T>&
+  reverse_quotient_update (const TA& a, const NumberArray<N,T2>& x, const TB& b)
+    {
+      Unroll<N>::apply([&](std::size_t i)
+        { _data[i] = x[i] / b - _data[i] * a / (b * b); });
+      return *this;
+    }
+
   void zero()
   {
     std::fill(_data, _data+N, T());
@@ -293,8 +332,7 @@ NumberArray<N, T>
 transpose(NumberArray<N, T> a)
 {
   NumberArray<N, T> returnval;
-  for (std::size_t i=0; i != N; ++i)
-      returnval[i] = transpose(a[i]);
+  Unroll<N>::apply([&](std::size_t i){ returnval[i] = transpose(a[i]); });
 
   return returnval;
 }
@@ -306,8 +344,7 @@ sum (const NumberArray<N, T>& a)
   NumberArray<N, typename SumType<T>::supertype>
     returnval = 0;
 
-  for (std::size_t i=0; i != N; ++i)
-    returnval[i] = a[i].sum();
+  Unroll<N>::apply([&](std::size_t i){ returnval[i] = a[i].sum(); });
 
   return returnval;
 }
@@ -318,8 +355,7 @@ sum (const NumberArray<N, T>& a)
       ->NumberArray<N, decltype(a[0] opname b[0])>                                                 \
   {                                                                                                \
     NumberArray<N, decltype(a[0] opname b[0])> returnval;                                          \
-    for (std::size_t i = 0; i != N; ++i)                                                           \
-      returnval[i] = a[i] opname b[i];                                                             \
+    Unroll<N>::apply([&](std::size_t i){ returnval[i] = a[i] opname b[i]; });                      \
                                                                                                    \
     return returnval;                                                                              \
   }                                                                                                \
@@ -328,8 +364,7 @@ sum (const NumberArray<N, T>& a)
       ->NumberArray<N, decltype(a opname b[0])>                                                    \
   {                                                                                                \
     NumberArray<N, decltype(a opname b[0])> returnval;                                             \
-    for (std::size_t i = 0; i != N; ++i)                                                           \
-      returnval[i] = a opname b[i];                                                                \
+    Unroll<N>::apply([&](std::size_t i){ returnval[i] = a opname b[i]; });                         \
                                                                                                    \
     return returnval;                                                                              \
   }                                                                                                \
@@ -338,8 +373,7 @@ sum (const NumberArray<N, T>& a)
       ->NumberArray<N, decltype(a[0] opname b)>                                                    \
   {                                                                                                \
     NumberArray<N, decltype(a[0] * b)> returnval;                                                  \
-    for (std::size_t i = 0; i != N; ++i)                                                           \
-      returnval[i] = a[i] opname b;                                                                \
+    Unroll<N>::apply([&](std::size_t i){ returnval[i] = a[i] opname b; });                         \
                                                                                                    \
     return returnval;                                                                              \
   }
@@ -358,8 +392,7 @@ operator opname (const atype& a, const btype& b) \
 { \
   NumberArray<N, bool> returnval; \
  \
-  for (std::size_t i=0; i != N; ++i) \
-    returnval[i] = (aarg opname barg); \
+  Unroll<N>::apply([&](std::size_t i){ returnval[i] = (aarg opname barg); }); \
  \
   return returnval; \
 }
@@ -393,6 +426,36 @@ operator<< (std::ostream& output, const NumberArray<N,T>& a)
 }
 
 
+// DualNumber product and quotient rules, done in place
+
+template <std::size_t N, typename T, typename TA, typename T2, typename TB>
+inline
+void
+dual_product_update (NumberArray<N,T>& da, const TA& a,
+                     const NumberArray<N,T2>& db, const TB& b)
+{
+  da.axpby(a, db, b);
+}
+
+template <std::size_t N, typename T, typename TA, typename T2, typename TB>
+inline
+void
+dual_quotient_update (NumberArray<N,T>& da, const TA& a,
+                      const NumberArray<N,T2>& db, const TB& b)
+{
+  da.quotient_update(a, db, b);
+}
+
+template <std::size_t N, typename T, typename TA, typename T2, typename TB>
+inline
+void
+dual_reverse_quotient_update (NumberArray<N,T>& db, const TA& a,
+                              const NumberArray<N,T2>& da, const TB& b)
+{
+  db.reverse_quotient_update(a, da, b);
+}
+
+
 // CompareTypes, RawType, ValueType specializations
 
 #define NumberArray_comparisons(templatename) \
@@ -536,7 +599,62 @@ NumberArray_std_binary(funcname) \
 NumberArray_fl_binary(funcname)
 
 
-NumberArray_std_binary(pow)
+// Defining METAPHYSICL_SIMD_MATH hands arrays of floating point
+// values to the vectorized kernels in simdmath.h.  They are faster
+// than libm but not correctly rounded; simdmath.h lists their error
+// bounds.
+#define NumberArray_simd_unary_T(funcname, T) \
+template <std::size_t N> \
+inline \
+NumberArray<N, T> \
+funcname (NumberArray<N, T> a) \
+{ \
+  MetaPhysicL::SIMDMath::funcname(N, &a[0], &a[0]); \
+  return a; \
+}
+
+#define NumberArray_simd_binary_T(funcname, T) \
+template <std::size_t N> \
+inline \
+NumberArray<N, T> \
+funcname (const NumberArray<N, T>& a, const NumberArray<N, T>& b) \
+{ \
+  NumberArray<N, T> returnval; \
+  MetaPhysicL::SIMDMath::funcname(N, &a[0], &b[0], &returnval[0]); \
+  return returnval; \
+}
+
+#define NumberArray_simd_unary(funcname) \
+NumberArray_simd_unary_T(funcname, double) \
+NumberArray_simd_unary_T(funcname, float)
+
+#define NumberArray_simd_binary(funcname) \
+NumberArray_simd_binary_T(funcname, double) \
+NumberArray_simd_binary_T(funcname, float)
+
+
+// pow classifies a scalar exponent once for the whole array
+NumberArray_std_binary_abab(pow, NumberArray<N MacroComma T>, NumberArray<N MacroComma T2>,
+                            NumberArray<N MacroComma T> MacroComma NumberArray<N MacroComma T2>, a[i], b[i])
+NumberArray_std_binary_abab(pow,                             T , NumberArray<N MacroComma T2>,
+                            NumberArray<N MacroComma T2> MacroComma T,                              a,    b[i])
+NumberArray_std_binary_aa(pow, NumberArray<N MacroComma T>)
+
+template <std::size_t N, typename T, typename T2>
+inline
+typename CompareTypes<NumberArray<N,T>, T2>::supertype
+pow (const NumberArray<N,T>& a, const T2& b)
+{
+  typedef typename CompareTypes<NumberArray<N,T>, T2>::supertype TS;
+  TS returnval;
+
+  const MetaPhysicL::FixedExponentPow<T2> powb(b);
+  for (std::size_t i=0; i != N; ++i)
+    returnval[i] = powb(a[i]);
+
+  return returnval;
+}
+
 NumberArray_std_unary(exp)
 NumberArray_std_unary(log)
 NumberArray_std_unary(log10)
@@ -559,6 +677,16 @@ NumberArray_std_unary(ceil)
 NumberArray_std_unary(floor)
 NumberArray_std_binary(fmod)
 
+#ifdef METAPHYSICL_SIMD_MATH
+NumberArray_simd_unary(exp)
+NumberArray_simd_unary(log)
+NumberArray_simd_unary(sin)
+NumberArray_simd_unary(cos)
+NumberArray_simd_unary(tanh)
+NumberArray_simd_unary(sqrt)
+NumberArray_simd_binary(atan2)
+#endif // METAPHYSICL_SIMD_MATH
+
 #if __cplusplus >= 201103L
 NumberArray_std_unary(llabs)
 NumberArray_std_unary(imaxabs)
@@ -603,6 +731,11 @@ NumberArray_stdfl_binary(fmin)
 NumberArray_stdfl_binary(fdim)
 NumberArray_stdfl_binary(hypot)
 NumberArray_fl_binary(atan2)
+
+#ifdef METAPHYSICL_SIMD_MATH
+NumberArray_simd_unary(erf)
+NumberArray_simd_binary(hypot)
+#endif // METAPHYSICL_SIMD_MATH
 #endif // __cplusplus >= 201103L
 
 
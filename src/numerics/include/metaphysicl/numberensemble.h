@@ -0,0 +1,626 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// MetaPhysicL - A metaprogramming library for physics calculations
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+//
+// $Id$
+//
+//--------------------------------------------------------------------------
+
+
+#ifndef METAPHYSICL_NUMBERENSEMBLE_H
+#define METAPHYSICL_NUMBERENSEMBLE_H
+
+#include <algorithm>
+#include <limits>
+#include <ostream>
+#include <utility> // for declval
+
+#include "metaphysicl/compare_types.h"
+#include "metaphysicl/ct_types.h"
+#include "metaphysicl/integerpow.h"
+#include "metaphysicl/metaprogramming.h" // for Unroll
+#include "metaphysicl/raw_type.h"
+#include "metaphysicl/simdmath.h"
+
+namespace MetaPhysicL {
+
+// A NumberEnsemble holds one value for each of W independent
+// evaluation points, one point per lane, so that a single evaluation
+// of templated code on NumberEnsemble (or DualNumber<NumberEnsemble>)
+// arguments processes W points at once, in loops simple enough for
+// the compiler to vectorize.
+//
+// Unlike a NumberArray, an ensemble is treated as a scalar by the
+// containers built from it: NumberArray<N, NumberEnsemble<W,T> > is
+// an N vector at each of W points, not a W vector of anything.
+// Comparisons return NumberEnsemble<W,bool> masks, and branches on
+// them have to be written with if_else(), which selects lane by lane.
+template <std::size_t W, typename T>
+class NumberEnsemble
+{
+public:
+  typedef T value_type;
+
+  template <typename T2>
+  struct rebind {
+    typedef NumberEnsemble<W, T2> other;
+  };
+
+  NumberEnsemble() = default;
+
+  NumberEnsemble(const T& val)
+    { std::fill(_data, _data+W, val); }
+
+  template <typename T2>
+  NumberEnsemble(const NumberEnsemble<W, T2>& src)
+    { Unroll<W>::apply([&](std::size_t l){ _data[l] = T(src[l]); }); }
+
+  template <typename T2,
+            typename std::enable_if<ScalarTraits<T2>::value,
+                                    int>::type = 0>
+  NumberEnsemble(const T2& val)
+    { std::fill(_data, _data+W, T(val)); }
+
+  template <typename T2,
+            typename std::enable_if<ScalarTraits<T2>::value,
+                                    int>::type = 0>
+  NumberEnsemble & operator=(const T2 & val)
+    {
+      std::fill(_data, _data+W, T(val));
+      return *this;
+    }
+
+  T& operator[](std::size_t l)
+    { return _data[l]; }
+
+  const T& operator[](std::size_t l) const
+    { return _data[l]; }
+
+  std::size_t size() const
+    { return W; }
+
+  // Negated bool masks are ints, as for builtins
+  NumberEnsemble<W, decltype(-std::declval<const T&>())> operator- () const {
+    NumberEnsemble<W, decltype(-std::declval<const T&>())> returnval;
+    Unroll<W>::apply([&](std::size_t l){ returnval[l] = -_data[l]; });
+    return returnval;
+  }
+
+  NumberEnsemble<W, bool> operator! () const {
+    NumberEnsemble<W, bool> returnval;
+    Unroll<W>::apply([&](std::size_t l){ returnval[l] = !_data[l]; });
+    return returnval;
+  }
+
+  template <typename T2>
+  NumberEnsemble<W,T>& operator+= (const NumberEnsemble<W,T2>& a)
+    { Unroll<W>::apply([&](std::size_t l){ _data[l] += a[l]; }); return *this; }
+
+  template <typename T2>
+  NumberEnsemble<W,T>& operator+= (const T2& a)
+    { Unroll<W>::apply([&](std::size_t l){ _data[l] += a; }); return *this; }
+
+  template <typename T2>
+  NumberEnsemble<W,T>& operator-= (const NumberEnsemble<W,T2>& a)
+    { Unroll<W>::apply([&](std::size_t l){ _data[l] -= a[l]; }); return *this; }
+
+  template <typename T2>
+  NumberEnsemble<W,T>& operator-= (const T2& a)
+    { Unroll<W>::apply([&](std::size_t l){ _data[l] -= a; }); return *this; }
+
+  template <typename T2>
+  NumberEnsemble<W,T>& operator*= (const NumberEnsemble<W,T2>& a)
+    { Unroll<W>::apply([&](std::size_t l){ _data[l] *= a[l]; }); return *this; }
+
+  template <typename T2>
+  NumberEnsemble<W,T>& operator*= (const T2& a)
+    { Unroll<W>::apply([&](std::size_t l){ _data[l] *= a; }); return *this; }
+
+  template <typename T2>
+  NumberEnsemble<W,T>& operator/= (const NumberEnsemble<W,T2>& a)
+    { Unroll<W>::apply([&](std::size_t l){ _data[l] /= a[l]; }); return *this; }
+
+  template <typename T2>
+  NumberEnsemble<W,T>& operator/= (const T2& a)
+    { Unroll<W>::apply([&](std::size_t l){ _data[l] /= a; }); return *this; }
+
+private:
+  T _data[W];
+};
+
+
+
+//
+// Lane access
+//
+
+// EnsembleType<W,T>::type is the ensemble counterpart of the single
+// point type T, and EnsembleSize<T>::value the number of lanes in an
+// ensemble type T.  Both are specialized for containers of ensembles
+// alongside their ensemble_insert, ensemble_extract and ensemble_blend
+// overloads.
+template <std::size_t W, typename T>
+struct EnsembleType
+{
+  typedef NumberEnsemble<W, T> type;
+};
+
+template <typename T>
+struct EnsembleSize;
+
+template <std::size_t W, typename T>
+struct EnsembleSize<NumberEnsemble<W, T> >
+{
+  static const std::size_t value = W;
+};
+
+
+// Sets lane l of an ensemble from a single point value
+template <std::size_t W, typename T, typename S>
+inline
+void
+ensemble_insert (NumberEnsemble<W,T>& a, std::size_t l, const S& val)
+{
+  a[l] = val;
+}
+
+// Sets a single point value from lane l of an ensemble
+template <std::size_t W, typename T, typename S>
+inline
+void
+ensemble_extract (const NumberEnsemble<W,T>& a, std::size_t l, S& val)
+{
+  val = a[l];
+}
+
+// Replaces the lanes of a where mask is false with those of b
+template <std::size_t W, typename T, typename B, typename T2>
+inline
+void
+ensemble_blend (NumberEnsemble<W,T>& a, const NumberEnsemble<W,B>& mask,
+                const NumberEnsemble<W,T2>& b)
+{
+  Unroll<W>::apply([&](std::size_t l){ if (!mask[l]) a[l] = b[l]; });
+}
+
+template <std::size_t W, typename T, typename B, typename T2>
+inline
+typename boostcopy::enable_if<BuiltinTraits<T2>, void>::type
+ensemble_blend (NumberEnsemble<W,T>& a, const NumberEnsemble<W,B>& mask,
+                const T2& b)
+{
+  const T bt = b;
+  Unroll<W>::apply([&](std::size_t l){ if (!mask[l]) a[l] = bt; });
+}
+
+
+// Loads the W points starting at points into the lanes of an
+// ensemble, or the points at the given W indices; callers with fewer
+// points than lanes can repeat an index to fill the rest.
+template <typename T, typename S>
+inline
+void
+ensemble_gather (const S * points, T& ensemble)
+{
+  for (std::size_t l = 0; l != EnsembleSize<T>::value; ++l)
+    ensemble_insert(ensemble, l, points[l]);
+}
+
+template <typename T, typename S, typename I>
+inline
+void
+ensemble_gather (const S * points, const I * indices, T& ensemble)
+{
+  for (std::size_t l = 0; l != EnsembleSize<T>::value; ++l)
+    ensemble_insert(ensemble, l, points[indices[l]]);
+}
+
+// Stores the lanes of an ensemble to W points, the inverse of
+// ensemble_gather
+template <typename T, typename S>
+inline
+void
+ensemble_scatter (const T& ensemble, S * points)
+{
+  for (std::size_t l = 0; l != EnsembleSize<T>::value; ++l)
+    ensemble_extract(ensemble, l, points[l]);
+}
+
+template <typename T, typename S, typename I>
+inline
+void
+ensemble_scatter (const T& ensemble, S * points, const I * indices)
+{
+  for (std::size_t l = 0; l != EnsembleSize<T>::value; ++l)
+    ensemble_extract(ensemble, l, points[indices[l]]);
+}
+
+
+
+//
+// Non-member functions
+//
+
+// The lane by lane "ternary" operator: returns if_true in lanes where
+// condition holds and if_false elsewhere.  Both are evaluated in every
+// lane, so each must be safe to compute at all W points.
+template <std::size_t W, typename B, typename T, typename T2>
+inline
+typename CompareTypes<typename SymmetricCompareTypes<T,T2>::supertype,
+                      NumberEnsemble<W,bool> >::supertype
+if_else (const NumberEnsemble<W,B> & condition, const T & if_true, const T2 & if_false)
+{
+  typename CompareTypes<typename SymmetricCompareTypes<T,T2>::supertype,
+                        NumberEnsemble<W,bool> >::supertype
+    returnval(if_true);
+  ensemble_blend(returnval, condition, if_false);
+
+  return returnval;
+}
+
+
+// Arithmetic and comparisons act lane by lane.  Operations with
+// non-ensemble arguments are limited to builtins, leaving ensembles
+// inside other types to those types' operators.
+#define NumberEnsemble_op(opname)                                                                  \
+  template <std::size_t W, typename T, typename T2>                                                \
+  inline auto operator opname(const NumberEnsemble<W, T> & a, const NumberEnsemble<W, T2> & b)     \
+      ->NumberEnsemble<W, decltype(a[0] opname b[0])>                                              \
+  {                                                                                                \
+    NumberEnsemble<W, decltype(a[0] opname b[0])> returnval;                                       \
+    Unroll<W>::apply([&](std::size_t l){ returnval[l] = a[l] opname b[l]; });                      \
+                                                                                                   \
+    return returnval;                                                                              \
+  }                                                                                                \
+  template <std::size_t W, typename T, typename T2>                                                \
+  inline auto operator opname(const T & a, const NumberEnsemble<W, T2> & b)                        \
+      ->typename boostcopy::enable_if<BuiltinTraits<T>,                                            \
+                                      NumberEnsemble<W, decltype(a opname b[0])> >::type           \
+  {                                                                                                \
+    NumberEnsemble<W, decltype(a opname b[0])> returnval;                                          \
+    Unroll<W>::apply([&](std::size_t l){ returnval[l] = a opname b[l]; });                         \
+                                                                                                   \
+    return returnval;                                                                              \
+  }                                                                                                \
+  template <std::size_t W, typename T, typename T2>                                                \
+  inline auto operator opname(const NumberEnsemble<W, T> & a, const T2 & b)                        \
+      ->typename boostcopy::enable_if<BuiltinTraits<T2>,                                           \
+                                      NumberEnsemble<W, decltype(a[0] opname b)> >::type           \
+  {                                                                                                \
+    NumberEnsemble<W, decltype(a[0] opname b)> returnval;                                          \
+    Unroll<W>::apply([&](std::size_t l){ returnval[l] = a[l] opname b; });                         \
+                                                                                                   \
+    return returnval;                                                                              \
+  }
+
+NumberEnsemble_op(+)
+NumberEnsemble_op(-)
+NumberEnsemble_op(*)
+NumberEnsemble_op(/)
+
+NumberEnsemble_op(<)
+NumberEnsemble_op(<=)
+NumberEnsemble_op(>)
+NumberEnsemble_op(>=)
+NumberEnsemble_op(==)
+NumberEnsemble_op(!=)
+NumberEnsemble_op(&&)
+NumberEnsemble_op(||)
+
+template <std::size_t W, typename T>
+inline
+std::ostream&
+operator<< (std::ostream& output, const NumberEnsemble<W,T>& a)
+{
+  output << '<';
+  if (W)
+    output << a[0];
+  for (std::size_t l=1; l<W; ++l)
+    output << ',' << a[l];
+  output << '>';
+  return output;
+}
+
+
+// CompareTypes, RawType, ValueType specializations
+
+#define NumberEnsemble_comparisons(templatename) \
+template<std::size_t W, typename T, bool reverseorder> \
+struct templatename<NumberEnsemble<W,T>, NumberEnsemble<W,T>, reverseorder> { \
+  typedef NumberEnsemble<W, T> supertype; \
+}; \
+ \
+template<std::size_t W, typename T, bool reverseorder> \
+struct templatename<NumberEnsemble<W,T>, NullType, reverseorder> { \
+  typedef NumberEnsemble<W, T> supertype; \
+}; \
+ \
+template<std::size_t W, typename T, bool reverseorder> \
+struct templatename<NullType, NumberEnsemble<W,T>, reverseorder> { \
+  typedef NumberEnsemble<W, T> supertype; \
+}; \
+ \
+template<std::size_t W, typename T, typename T2, bool reverseorder> \
+struct templatename<NumberEnsemble<W,T>, NumberEnsemble<W,T2>, reverseorder> { \
+  typedef NumberEnsemble<W, typename Symmetric##templatename<T, T2, reverseorder>::supertype> supertype; \
+}; \
+ \
+template<std::size_t W, typename T, typename T2, bool reverseorder> \
+struct templatename<NumberEnsemble<W,T>, T2, reverseorder, \
+                    typename boostcopy::enable_if<BuiltinTraits<T2> >::type> { \
+  typedef NumberEnsemble<W, typename Symmetric##templatename<T, T2, reverseorder>::supertype> supertype; \
+}; \
+ \
+template<std::size_t W, typename T, typename T2, bool reverseorder> \
+struct templatename<T2, NumberEnsemble<W,T>, reverseorder, \
+                    typename boostcopy::enable_if<BuiltinTraits<T2> >::type> { \
+  typedef NumberEnsemble<W, typename Symmetric##templatename<T2, T, reverseorder>::supertype> supertype; \
+}
+
+NumberEnsemble_comparisons(CompareTypes);
+NumberEnsemble_comparisons(PlusType);
+NumberEnsemble_comparisons(MinusType);
+NumberEnsemble_comparisons(MultipliesType);
+NumberEnsemble_comparisons(DividesType);
+NumberEnsemble_comparisons(AndType);
+NumberEnsemble_comparisons(OrType);
+
+template <std::size_t W, typename T>
+struct RawType<NumberEnsemble<W, T> >
+{
+  typedef NumberEnsemble<W, typename RawType<T>::value_type> value_type;
+
+  static value_type value(const NumberEnsemble<W, T>& a)
+    {
+      value_type returnval;
+      for (std::size_t l=0; l != W; ++l)
+        returnval[l] = RawType<T>::value(a[l]);
+      return returnval;
+    }
+};
+
+template <std::size_t W, typename T>
+struct ValueType<NumberEnsemble<W, T> >
+{
+  typedef typename ValueType<T>::type type;
+};
+
+// Integer and half-integer powers of ensembles are squared lane by
+// lane, with no per-lane branching on the exponent
+template <std::size_t W, typename T>
+struct FastPowTraits<NumberEnsemble<W, T> >
+{
+  static const bool value = FastPowTraits<T>::value;
+};
+
+} // namespace MetaPhysicL
+
+
+namespace std {
+
+using MetaPhysicL::NumberEnsemble;
+using MetaPhysicL::CompareTypes;
+
+#define NumberEnsemble_std_unary(funcname) \
+template <std::size_t W, typename T> \
+inline \
+NumberEnsemble<W, T> \
+funcname (NumberEnsemble<W, T> a) \
+{ \
+  for (std::size_t l=0; l != W; ++l) \
+    a[l] = std::funcname(a[l]); \
+ \
+  return a; \
+}
+
+
+// Arguments are converted to the supertype's lane type first, so that
+// e.g. max(ensemble of floats, double) finds a single std::max
+#define NumberEnsemble_std_binary_abab(funcname, atype, btype, abtypes, aarg, barg, enabletype) \
+template <std::size_t W, typename T, typename T2> \
+inline \
+typename MetaPhysicL::boostcopy::enable_if<enabletype, \
+  typename CompareTypes<abtypes>::supertype>::type \
+funcname (const atype& a, const btype& b) \
+{ \
+  typedef typename CompareTypes<abtypes>::supertype TS; \
+  typedef typename TS::value_type TV; \
+  TS returnval; \
+ \
+  for (std::size_t l=0; l != W; ++l) \
+    returnval[l] = std::funcname(TV(aarg), TV(barg)); \
+ \
+  return returnval; \
+}
+
+#define NumberEnsemble_std_binary_aa(funcname, atype) \
+template <std::size_t W, typename T> \
+inline \
+atype \
+funcname (const atype& a, const atype& b) \
+{ \
+  atype returnval; \
+ \
+  for (std::size_t l=0; l != W; ++l) \
+    returnval[l] = std::funcname(a[l], b[l]); \
+ \
+  return returnval; \
+}
+
+#define NumberEnsemble_std_binary_ensemble_b(funcname) \
+NumberEnsemble_std_binary_abab(funcname, NumberEnsemble<W MacroComma T>, NumberEnsemble<W MacroComma T2>, \
+                               NumberEnsemble<W MacroComma T> MacroComma NumberEnsemble<W MacroComma T2>, \
+                               a[l], b[l], MetaPhysicL::TrueType) \
+NumberEnsemble_std_binary_abab(funcname,                                T , NumberEnsemble<W MacroComma T2>, \
+                               NumberEnsemble<W MacroComma T2> MacroComma T, \
+                               a,    b[l], MetaPhysicL::BuiltinTraits<T>) \
+NumberEnsemble_std_binary_aa(funcname, NumberEnsemble<W MacroComma T>)
+
+#define NumberEnsemble_std_binary(funcname) \
+NumberEnsemble_std_binary_ensemble_b(funcname) \
+NumberEnsemble_std_binary_abab(funcname, NumberEnsemble<W MacroComma T>,                                T2 , \
+                               NumberEnsemble<W MacroComma T> MacroComma T2, \
+                               a[l], b,    MetaPhysicL::BuiltinTraits<T2>)
+
+
+// As for NumberArray, ensembles of floating point values hand off to
+// the vectorized kernels only if METAPHYSICL_SIMD_MATH is defined
+#define NumberEnsemble_simd_unary_T(funcname, T) \
+template <std::size_t W> \
+inline \
+NumberEnsemble<W, T> \
+funcname (NumberEnsemble<W, T> a) \
+{ \
+  MetaPhysicL::SIMDMath::funcname(W, &a[0], &a[0]); \
+  return a; \
+}
+
+#define NumberEnsemble_simd_binary_T(funcname, T) \
+template <std::size_t W> \
+inline \
+NumberEnsemble<W, T> \
+funcname (const NumberEnsemble<W, T>& a, const NumberEnsemble<W, T>& b) \
+{ \
+  NumberEnsemble<W, T> returnval; \
+  MetaPhysicL::SIMDMath::funcname(W, &a[0], &b[0], &returnval[0]); \
+  return returnval; \
+}
+
+#define NumberEnsemble_simd_unary(funcname) \
+NumberEnsemble_simd_unary_T(funcname, double) \
+NumberEnsemble_simd_unary_T(funcname, float)
+
+#define NumberEnsemble_simd_binary(funcname) \
+NumberEnsemble_simd_binary_T(funcname, double) \
+NumberEnsemble_simd_binary_T(funcname, float)
+
+
+// pow classifies a scalar exponent once for the whole ensemble
+NumberEnsemble_std_binary_ensemble_b(pow)
+
+template <std::size_t W, typename T, typename T2>
+inline
+typename MetaPhysicL::boostcopy::enable_if<MetaPhysicL::BuiltinTraits<T2>,
+  typename CompareTypes<NumberEnsemble<W,T>, T2>::supertype>::type
+pow (const NumberEnsemble<W,T>& a, const T2& b)
+{
+  return MetaPhysicL::FixedExponentPow<T2>(b)(a);
+}
+
+NumberEnsemble_std_unary(exp)
+NumberEnsemble_std_unary(log)
+NumberEnsemble_std_unary(log10)
+NumberEnsemble_std_unary(sin)
+NumberEnsemble_std_unary(cos)
+NumberEnsemble_std_unary(tan)
+NumberEnsemble_std_unary(asin)
+NumberEnsemble_std_unary(acos)
+NumberEnsemble_std_unary(atan)
+NumberEnsemble_std_binary(atan2)
+NumberEnsemble_std_unary(sinh)
+NumberEnsemble_std_unary(cosh)
+NumberEnsemble_std_unary(tanh)
+NumberEnsemble_std_unary(sqrt)
+NumberEnsemble_std_unary(abs)
+NumberEnsemble_std_unary(fabs)
+NumberEnsemble_std_binary(max)
+NumberEnsemble_std_binary(min)
+NumberEnsemble_std_unary(ceil)
+NumberEnsemble_std_unary(floor)
+NumberEnsemble_std_binary(fmod)
+
+#ifdef METAPHYSICL_SIMD_MATH
+NumberEnsemble_simd_unary(exp)
+NumberEnsemble_simd_unary(log)
+NumberEnsemble_simd_unary(sin)
+NumberEnsemble_simd_unary(cos)
+NumberEnsemble_simd_unary(tanh)
+NumberEnsemble_simd_unary(sqrt)
+NumberEnsemble_simd_binary(atan2)
+#endif // METAPHYSICL_SIMD_MATH
+
+#if __cplusplus >= 201103L
+NumberEnsemble_std_unary(exp2)
+NumberEnsemble_std_unary(expm1)
+NumberEnsemble_std_unary(log2)
+NumberEnsemble_std_unary(log1p)
+NumberEnsemble_std_unary(cbrt)
+NumberEnsemble_std_unary(asinh)
+NumberEnsemble_std_unary(acosh)
+NumberEnsemble_std_unary(atanh)
+NumberEnsemble_std_unary(erf)
+NumberEnsemble_std_unary(erfc)
+NumberEnsemble_std_unary(tgamma)
+NumberEnsemble_std_unary(lgamma)
+NumberEnsemble_std_unary(trunc)
+NumberEnsemble_std_unary(round)
+NumberEnsemble_std_unary(nearbyint)
+NumberEnsemble_std_unary(rint)
+
+NumberEnsemble_std_binary(remainder)
+NumberEnsemble_std_binary(fmax)
+NumberEnsemble_std_binary(fmin)
+NumberEnsemble_std_binary(fdim)
+NumberEnsemble_std_binary(hypot)
+
+#ifdef METAPHYSICL_SIMD_MATH
+NumberEnsemble_simd_unary(erf)
+NumberEnsemble_simd_binary(hypot)
+#endif // METAPHYSICL_SIMD_MATH
+#endif // __cplusplus >= 201103L
+
+
+template <std::size_t W, typename T>
+class numeric_limits<NumberEnsemble<W, T> > :
+  public MetaPhysicL::raw_numeric_limits<NumberEnsemble<W, T>, T> {};
+
+} // namespace std
+
+
+namespace MetaPhysicL {
+
+// For fast_pow, which may have been declared before the std functions
+// above
+template <std::size_t W, typename T>
+inline
+NumberEnsemble<W, T>
+fast_pow_sqrt (const NumberEnsemble<W, T> & x)
+{
+  return std::sqrt(x);
+}
+
+// Lanes are squared together, so all of them have to be in range
+template <std::size_t W, typename T>
+inline
+bool
+fast_pow_base (const NumberEnsemble<W, T> & x, int twice_b)
+{
+  for (std::size_t l = 0; l != W; ++l)
+    if (!fast_pow_base(x[l], twice_b))
+      return false;
+  return true;
+}
+
+} // namespace MetaPhysicL
+
+
+#endif // METAPHYSICL_NUMBERENSEMBLE_H
@@ -35,6 +35,7 @@
 
 #include "metaphysicl/compare_types.h"
 #include "metaphysicl/ct_types.h"
+#include "metaphysicl/metaprogramming.h" // for Unroll
 #include "metaphysicl/metaphysicl_asserts.h"
 #include "metaphysicl/raw_type.h"
 
@@ -60,6 +61,11 @@ struct SumType<NumberVector<N,S> > {
   typedef S supertype;
 };
 
+template <std::size_t N, typename T>
+struct DenseTraits<NumberVector<N,T> > {
+  static const bool value = true;
+};
+
 template <std::size_t N, typename T>
 class NumberVector
 {
@@ -135,55 +141,54 @@ public:
 
   NumberVector<N,T> operator- () const {
     NumberVector<N,T> returnval;
-    for (std::size_t i=0; i != N; ++i) returnval[i] = -_data[i];
+    Unroll<N>::apply([&](std::size_t i){ returnval[i] = -_data[i]; });
     return returnval;
   }
 
   NumberVector<N,T> operator! () const {
     NumberVector<N,T> returnval;
-    for (std::size_t i=0; i != N; ++i) returnval[i] = !_data[i];
+    Unroll<N>::apply([&](std::size_t i){ returnval[i] = !_data[i]; });
     return returnval;
   }
 
   template <typename T2>
   NumberVector<N,T>& operator+= (const NumberVector<N,T2>& a)
-    { for (std::size_t i=0; i != N; ++i) _data[i] += a[i]; return *this; }
+    { Unroll<N>::apply([&](std::size_t i){ _data[i] += a[i]; }); return *this; }
 
   template <typename T2>
   NumberVector<N,T>& operator+= (const T2& a)
-    { for (std::size_t i=0; i != N; ++i) _data[i] += a; return *this; }
+    { Unroll<N>::apply([&](std::size_t i){ _data[i] += a; }); return *this; }
 
   template <typename T2>
   NumberVector<N,T>& operator-= (const NumberVector<N,T2>& a)
-    { for (std::size_t i=0; i != N; ++i) _data[i] -= a[i]; return *this; }
+    { Unroll<N>::apply([&](std::size_t i){ _data[i] -= a[i]; }); return *this; }
 
   template <typename T2>
   NumberVector<N,T>& operator-= (const T2& a)
-    { for (std::size_t i=0; i != N; ++i) _data[i] -= a; return *this; }
+    { Unroll<N>::apply([&](std::size_t i){ _data[i] -= a; }); return *this; }
 
   template <typename T2>
   NumberVector<N,T>& operator*= (const NumberVector<N,T2>& a)
-    { for (std::size_t i=0; i != N; ++i) _data[i] *= a[i]; return *this; }
+    { Unroll<N>::apply([&](std::size_t i){ _data[i] *= a[i]; }); return *this; }
 
   template <typename T2>
   NumberVector<N,T>& operator*= (const T2& a)
-    { for (std::size_t i=0; i != N; ++i) _data[i] *= a; return *this; }
+    { Unroll<N>::apply([&](std::size_t i){ _data[i] *= a; }); return *this; }
 
   template <typename T2>
   NumberVector<N,T>& operator/= (const NumberVector<N,T2>& a)
-    { for (std::size_t i=0; i != N; ++i) _data[i] /= a[i]; return *this; }
+    { Unroll<N>::apply([&](std::size_t i){ _data[i] /= a[i]; }); return *this; }
 
   template <typename T2>
   NumberVector<N,T>& operator/= (const T2& a)
-    { for (std::size_t i=0; i != N; ++i) _data[i] /= a; return *this; }
+    { Unroll<N>::apply([&](std::size_t i){ _data[i] /= a; }); return *this; }
 
   template <typename T2>
   typename SymmetricMultipliesType<T,T2>::supertype
   dot (const NumberVector<N,T2>& a) const
   {
     typename SymmetricMultipliesType<T,T2>::supertype returnval = 0;
-    for (std::size_t i=0; i != N; ++i)
-      returnval += _data[i] * a[i];
+    Unroll<N>::apply([&](std::size_t i){ returnval += _data[i] * a[i]; });
     return returnval;
   }
 
@@ -193,9 +198,9 @@ public:
   {
     NumberVector<N, NumberVector<N, typename SymmetricMultipliesType<T,T2>::supertype> > returnval;
 
-    for (std::size_t i=0; i != N; ++i)
-      for (std::size_t j=0; j != N; ++j)
-        returnval[i][j] = _data[i] * a[j];
+    Unroll<N>::apply([&](std::size_t i){
+      Unroll<N>::apply([&](std::size_t j){ returnval[i][j] = _data[i] * a[j]; });
+    });
 
     return returnval;
   }
@@ -303,9 +308,9 @@ inline
 NumberVector<N, NumberVector<N, T> >
 transpose(NumberVector<N, NumberVector<N, T> > a)
 {
-  for (std::size_t i=0; i != N; ++i)
-    for (std::size_t j=i+1; j != N; ++j)
-      std::swap(a[i][j], a[j][i]);
+  Unroll<N>::apply([&](std::size_t i){
+    Unroll<N>::apply([&](std::size_t j){ if (j > i) std::swap(a[i][j], a[j][i]); });
+  });
 
   return a;
 }
@@ -316,8 +321,7 @@ T sum (const NumberVector<N, T> &a)
 {
   T returnval = 0;
 
-  for (std::size_t i=0; i != N; ++i)
-    returnval += a[i];
+  Unroll<N>::apply([&](std::size_t i){ returnval += a[i]; });
 
   return returnval;
 }
@@ -358,8 +362,7 @@ operator opname (const atype& a, const btype& b) \
 { \
   NumberVector<N, bool> returnval; \
  \
-  for (std::size_t i=0; i != N; ++i) \
-    returnval[i] = (aarg opname barg); \
+  Unroll<N>::apply([&](std::size_t i){ returnval[i] = (aarg opname barg); }); \
  \
   return returnval; \
 }
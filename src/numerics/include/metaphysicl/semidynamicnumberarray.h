@@ -0,0 +1,691 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// MetaPhysicL - A metaprogramming library for physics calculations
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+//
+// $Id$
+//
+//--------------------------------------------------------------------------
+
+#ifndef METAPHYSICL_SEMIDYNAMICNUMBERARRAY_H
+#define METAPHYSICL_SEMIDYNAMICNUMBERARRAY_H
+
+#include <algorithm>
+#include <ostream>
+
+#include "metaphysicl/compare_types.h"
+#include "metaphysicl/ct_types.h"
+#include "metaphysicl/integerpow.h"
+#include "metaphysicl/metaphysicl_asserts.h"
+#include "metaphysicl/raw_type.h"
+
+namespace MetaPhysicL {
+
+// SemiDynamicNumberArray<N,T> stores up to N values on the stack, like
+// NumberArray<N,T>, but keeps a runtime size n <= N and treats every
+// entry past n as zero.  Operations loop only over the entries in
+// use, so derivative arrays sized for the most independent variables
+// any element may need cost only as much as each element actually
+// uses.
+//
+// Writing through operator[] past the current size grows the array,
+// zero filling any gap; reading past it gives zero.
+
+template <std::size_t N, typename T>
+class SemiDynamicNumberArray
+{
+public:
+  typedef T value_type;
+
+  template <typename T2>
+  struct rebind {
+    typedef SemiDynamicNumberArray<N, T2> other;
+  };
+
+  SemiDynamicNumberArray() : _size(0) {}
+
+  SemiDynamicNumberArray(const SemiDynamicNumberArray<N,T>& src)
+    : _size(src._size)
+    { std::copy(src._data, src._data+_size, _data); }
+
+  template <typename T2>
+  SemiDynamicNumberArray(const SemiDynamicNumberArray<N,T2>& src)
+    : _size(src.size())
+    {
+      for (std::size_t i=0; i != _size; ++i)
+        _data[i] = src.raw_at(i);
+    }
+
+  // Constant values; zero leaves us empty
+  template <typename T2,
+            typename std::enable_if<ScalarTraits<T2>::value,
+                                    int>::type = 0>
+  SemiDynamicNumberArray(const T2& val)
+    : _size(0)
+    { *this = val; }
+
+  SemiDynamicNumberArray<N,T>& operator= (const SemiDynamicNumberArray<N,T>& src)
+    {
+      _size = src._size;
+      std::copy(src._data, src._data+_size, _data);
+      return *this;
+    }
+
+  template <typename T2,
+            typename std::enable_if<ScalarTraits<T2>::value,
+                                    int>::type = 0>
+  SemiDynamicNumberArray<N,T>& operator= (const T2& val)
+    {
+      if (val == T2(0))
+        _size = 0;
+      else
+        {
+          _size = N;
+          std::fill(_data, _data+N, T(val));
+        }
+      return *this;
+    }
+
+  T& operator[] (std::size_t i)
+    {
+      if (i >= _size)
+        this->resize(i+1);
+      return _data[i];
+    }
+
+  const T& operator[] (std::size_t i) const
+    {
+      static const T zero = 0;
+      return (i < _size) ? _data[i] : zero;
+    }
+
+  T& raw_at (std::size_t i)
+    { metaphysicl_assert_less(i, _size); return _data[i]; }
+
+  const T& raw_at (std::size_t i) const
+    { metaphysicl_assert_less(i, _size); return _data[i]; }
+
+  T* raw_data ()
+    { return _data; }
+
+  const T* raw_data () const
+    { return _data; }
+
+  std::size_t size() const
+    { return _size; }
+
+  static std::size_t capacity()
+    { return N; }
+
+  // Growing zero fills the new entries
+  void resize (std::size_t n)
+    {
+      metaphysicl_assert_less_equal(n, N);
+      if (n > _size)
+        std::fill(_data+_size, _data+n, T(0));
+      _size = n;
+    }
+
+  void zero()
+    { _size = 0; }
+
+  SemiDynamicNumberArray<N,T> operator- () const {
+    SemiDynamicNumberArray<N,T> returnval;
+    returnval._size = _size;
+    for (std::size_t i=0; i != _size; ++i) returnval._data[i] = -_data[i];
+    return returnval;
+  }
+
+  // !0 is true, so every entry is in use
+  SemiDynamicNumberArray<N,T> operator! () const {
+    SemiDynamicNumberArray<N,T> returnval;
+    returnval._size = N;
+    for (std::size_t i=0; i != N; ++i) returnval._data[i] = !(*this)[i];
+    return returnval;
+  }
+
+  template <typename T2>
+  SemiDynamicNumberArray<N,T>& operator+= (const SemiDynamicNumberArray<N,T2>& a)
+    {
+      if (a.size() > _size)
+        this->resize(a.size());
+      for (std::size_t i=0; i != a.size(); ++i) _data[i] += a.raw_at(i);
+      return *this;
+    }
+
+  template <typename T2>
+  SemiDynamicNumberArray<N,T>& operator+= (const T2& a)
+    {
+      this->resize(N);
+      for (std::size_t i=0; i != N; ++i) _data[i] += a;
+      return *this;
+    }
+
+  template <typename T2>
+  SemiDynamicNumberArray<N,T>& operator-= (const SemiDynamicNumberArray<N,T2>& a)
+    {
+      if (a.size() > _size)
+        this->resize(a.size());
+      for (std::size_t i=0; i != a.size(); ++i) _data[i] -= a.raw_at(i);
+      return *this;
+    }
+
+  template <typename T2>
+  SemiDynamicNumberArray<N,T>& operator-= (const T2& a)
+    {
+      this->resize(N);
+      for (std::size_t i=0; i != N; ++i) _data[i] -= a;
+      return *this;
+    }
+
+  // Our entries past a's size are multiplied by zero
+  template <typename T2>
+  SemiDynamicNumberArray<N,T>& operator*= (const SemiDynamicNumberArray<N,T2>& a)
+    {
+      _size = std::min(_size, a.size());
+      for (std::size_t i=0; i != _size; ++i) _data[i] *= a.raw_at(i);
+      return *this;
+    }
+
+  template <typename T2>
+  SemiDynamicNumberArray<N,T>& operator*= (const T2& a)
+    { for (std::size_t i=0; i != _size; ++i) _data[i] *= a; return *this; }
+
+  // Entries past a's size are divided by zero, so we keep them
+  template <typename T2>
+  SemiDynamicNumberArray<N,T>& operator/= (const SemiDynamicNumberArray<N,T2>& a)
+    {
+      this->resize(N);
+      for (std::size_t i=0; i != N; ++i) _data[i] /= a[i];
+      return *this;
+    }
+
+  template <typename T2>
+  SemiDynamicNumberArray<N,T>& operator/= (const T2& a)
+    { for (std::size_t i=0; i != _size; ++i) _data[i] /= a; return *this; }
+
+  // Fused in-place update *this = *this * b + a * x, the DualNumber
+  // product rule, without temporaries.
+  template <typename TA, typename T2, typename TB>
+  SemiDynamicNumberArray<N,T>&
+  axpby (const TA& a, const SemiDynamicNumberArray<N,T2>& x, const TB& b)
+    {
+      const std::size_t common = std::min(_size, x.size());
+      for (std::size_t i=0; i != common; ++i)
+        _data[i] = _data[i] * b + a * x.raw_at(i);
+      for (std::size_t i=common; i < _size; ++i)
+        _data[i] *= b;
+      for (std::size_t i=common; i < x.size(); ++i)
+        _data[i] = a * x.raw_at(i);
+      _size = std::max(_size, x.size());
+      return *this;
+    }
+
+  // Fused in-place update *this = *this / b - x * a / (b * b), the
+  // quotient rule counterpart of axpby.
+  template <typename TA, typename T2, typename TB>
+  SemiDynamicNumberArray<N,T>&
+  quotient_update (const TA& a, const SemiDynamicNumberArray<N,T2>& x, const TB& b)
+    {
+      const std::size_t common = std::min(_size, x.size());
+      for (std::size_t i=0; i != common; ++i)
+        _data[i] = _data[i] / b - x.raw_at(i) * a / (b * b);
+      for (std::size_t i=common; i < _size; ++i)
+        _data[i] /= b;
+      for (std::size_t i=common; i < x.size(); ++i)
+        _data[i] = -(x.raw_at(i) * a / (b * b));
+      _size = std::max(_size, x.size());
+      return *this;
+    }
+
+  // Fused in-place update *this = x / b - *this * a / (b * b), for
+  // quotients whose denominator derivatives we are overwriting.
+  template <typename TA, typename T2, typename TB>
+  SemiDynamicNumberArray<N,T>&
+  reverse_quotient_update (const TA& a, const SemiDynamicNumberArray<N,T2>& x, const TB& b)
+    {
+      const std::size_t common = std::min(_size, x.size());
+      for (std::size_t i=0; i != common; ++i)
+        _data[i] = x.raw_at(i) / b - _data[i] * a / (b * b);
+      for (std::size_t i=common; i < _size; ++i)
+        _data[i] = -(_data[i] * a / (b * b));
+      for (std::size_t i=common; i < x.size(); ++i)
+        _data[i] = x.raw_at(i) / b;
+      _size = std::max(_size, x.size());
+      return *this;
+    }
+
+private:
+  T _data[N];
+  std::size_t _size;
+};
+
+
+
+//
+// Non-member functions
+//
+
+// Array-array operations go through the compound operators, which
+// touch only the entries in use
+#define SemiDynamicNumberArray_op(opname)                                      \
+template <std::size_t N, typename T, typename T2>                              \
+inline auto operator opname (const SemiDynamicNumberArray<N, T> & a,           \
+                             const SemiDynamicNumberArray<N, T2> & b)          \
+  -> SemiDynamicNumberArray<N, decltype(a[0] opname b[0])>                     \
+{                                                                              \
+  SemiDynamicNumberArray<N, decltype(a[0] opname b[0])> returnval = a;         \
+  returnval opname##= b;                                                       \
+  return returnval;                                                            \
+}                                                                              \
+                                                                               \
+template <std::size_t N, typename T, typename T2>                              \
+inline auto operator opname (const SemiDynamicNumberArray<N, T> & a,           \
+                             const T2 & b)                                     \
+  -> SemiDynamicNumberArray<N, decltype(a[0] opname b)>                        \
+{                                                                              \
+  SemiDynamicNumberArray<N, decltype(a[0] opname b)> returnval = a;            \
+  returnval opname##= b;                                                       \
+  return returnval;                                                            \
+}
+
+SemiDynamicNumberArray_op(+)
+SemiDynamicNumberArray_op(-)
+SemiDynamicNumberArray_op(*)
+SemiDynamicNumberArray_op(/)
+
+// With a scalar first, a * b keeps b's size; a + b, a - b and a / b
+// fill in every entry
+template <std::size_t N, typename T, typename T2>
+inline auto operator * (const T & a, const SemiDynamicNumberArray<N, T2> & b)
+  -> SemiDynamicNumberArray<N, decltype(a * b[0])>
+{
+  SemiDynamicNumberArray<N, decltype(a * b[0])> returnval;
+  returnval.resize(b.size());
+  for (std::size_t i = 0; i != b.size(); ++i)
+    returnval.raw_at(i) = a * b.raw_at(i);
+  return returnval;
+}
+
+#define SemiDynamicNumberArray_op_scalar_first(opname)                         \
+template <std::size_t N, typename T, typename T2>                              \
+inline auto operator opname (const T & a,                                      \
+                             const SemiDynamicNumberArray<N, T2> & b)          \
+  -> SemiDynamicNumberArray<N, decltype(a opname b[0])>                        \
+{                                                                              \
+  SemiDynamicNumberArray<N, decltype(a opname b[0])> returnval;                \
+  returnval.resize(N);                                                         \
+  for (std::size_t i = 0; i != N; ++i)                                         \
+    returnval.raw_at(i) = a opname b[i];                                       \
+  return returnval;                                                            \
+}
+
+SemiDynamicNumberArray_op_scalar_first(+)
+SemiDynamicNumberArray_op_scalar_first(-)
+SemiDynamicNumberArray_op_scalar_first(/)
+
+
+// Comparisons see the implicit zeros too, so the results are full
+#define SemiDynamicNumberArray_operator_binary_abab(opname, atype, btype, aarg, barg) \
+template <std::size_t N, typename T, typename T2> \
+inline \
+SemiDynamicNumberArray<N, bool> \
+operator opname (const atype& a, const btype& b) \
+{ \
+  SemiDynamicNumberArray<N, bool> returnval; \
+  returnval.resize(N); \
+ \
+  for (std::size_t i=0; i != N; ++i) \
+    returnval.raw_at(i) = (aarg opname barg); \
+ \
+  return returnval; \
+}
+
+#define SemiDynamicNumberArray_operator_binary(opname) \
+SemiDynamicNumberArray_operator_binary_abab(opname, SemiDynamicNumberArray<N MacroComma T>, SemiDynamicNumberArray<N MacroComma T2>, a[i], b[i]) \
+SemiDynamicNumberArray_operator_binary_abab(opname,                                        T , SemiDynamicNumberArray<N MacroComma T2>, a,    b[i]) \
+SemiDynamicNumberArray_operator_binary_abab(opname, SemiDynamicNumberArray<N MacroComma T>,                                        T2 , a[i], b)
+
+SemiDynamicNumberArray_operator_binary(<)
+SemiDynamicNumberArray_operator_binary(<=)
+SemiDynamicNumberArray_operator_binary(>)
+SemiDynamicNumberArray_operator_binary(>=)
+SemiDynamicNumberArray_operator_binary(==)
+SemiDynamicNumberArray_operator_binary(!=)
+SemiDynamicNumberArray_operator_binary(&&)
+SemiDynamicNumberArray_operator_binary(||)
+
+template <std::size_t N, typename T>
+inline
+std::ostream&
+operator<< (std::ostream& output, const SemiDynamicNumberArray<N,T>& a)
+{
+  output << '{';
+  if (a.size())
+    output << a[0];
+  for (std::size_t i=1; i<a.size(); ++i)
+    output << ',' << a[i];
+  output << '}';
+  return output;
+}
+
+
+// DualNumber product and quotient rules, done in place
+
+template <std::size_t N, typename T, typename TA, typename T2, typename TB>
+inline
+void
+dual_product_update (SemiDynamicNumberArray<N,T>& da, const TA& a,
+                     const SemiDynamicNumberArray<N,T2>& db, const TB& b)
+{
+  da.axpby(a, db, b);
+}
+
+template <std::size_t N, typename T, typename TA, typename T2, typename TB>
+inline
+void
+dual_quotient_update (SemiDynamicNumberArray<N,T>& da, const TA& a,
+                      const SemiDynamicNumberArray<N,T2>& db, const TB& b)
+{
+  da.quotient_update(a, db, b);
+}
+
+template <std::size_t N, typename T, typename TA, typename T2, typename TB>
+inline
+void
+dual_reverse_quotient_update (SemiDynamicNumberArray<N,T>& db, const TA& a,
+                              const SemiDynamicNumberArray<N,T2>& da, const TB& b)
+{
+  db.reverse_quotient_update(a, da, b);
+}
+
+
+// CompareTypes, RawType, ValueType specializations
+
+#define SemiDynamicNumberArray_comparisons(templatename) \
+template<std::size_t N, typename T, bool reverseorder> \
+struct templatename<SemiDynamicNumberArray<N,T>, SemiDynamicNumberArray<N,T>, reverseorder> { \
+  typedef SemiDynamicNumberArray<N, T> supertype; \
+}; \
+ \
+template<std::size_t N, typename T, bool reverseorder> \
+struct templatename<SemiDynamicNumberArray<N,T>, NullType, reverseorder> { \
+  typedef SemiDynamicNumberArray<N, T> supertype; \
+}; \
+ \
+template<std::size_t N, typename T, bool reverseorder> \
+struct templatename<NullType, SemiDynamicNumberArray<N,T>, reverseorder> { \
+  typedef SemiDynamicNumberArray<N, T> supertype; \
+}; \
+ \
+template<std::size_t N, typename T, typename T2, bool reverseorder> \
+struct templatename<SemiDynamicNumberArray<N,T>, SemiDynamicNumberArray<N,T2>, reverseorder> { \
+  typedef SemiDynamicNumberArray<N, typename Symmetric##templatename<T, T2, reverseorder>::supertype> supertype; \
+}; \
+ \
+template<std::size_t N, std::size_t N2, typename T, typename T2, bool reverseorder> \
+struct templatename<SemiDynamicNumberArray<N,T>, SemiDynamicNumberArray<N2,T2>, reverseorder> { \
+  typedef SemiDynamicNumberArray<0, int> supertype; \
+}; \
+ \
+template<std::size_t N, typename T, typename T2, bool reverseorder> \
+struct templatename<SemiDynamicNumberArray<N, T>, T2, reverseorder> { \
+  typedef SemiDynamicNumberArray<N, typename Symmetric##templatename<T, T2, reverseorder>::supertype> supertype; \
+}
+
+SemiDynamicNumberArray_comparisons(CompareTypes);
+SemiDynamicNumberArray_comparisons(PlusType);
+SemiDynamicNumberArray_comparisons(MinusType);
+SemiDynamicNumberArray_comparisons(MultipliesType);
+SemiDynamicNumberArray_comparisons(DividesType);
+SemiDynamicNumberArray_comparisons(AndType);
+SemiDynamicNumberArray_comparisons(OrType);
+
+template <std::size_t N, typename T>
+struct RawType<SemiDynamicNumberArray<N, T> >
+{
+  typedef SemiDynamicNumberArray<N, typename RawType<T>::value_type> value_type;
+
+  static value_type value(const SemiDynamicNumberArray<N, T>& a)
+    {
+      value_type returnval;
+      returnval.resize(a.size());
+      for (std::size_t i=0; i != a.size(); ++i)
+        returnval.raw_at(i) = RawType<T>::value(a.raw_at(i));
+      return returnval;
+    }
+};
+
+template <std::size_t N, typename T>
+struct ValueType<SemiDynamicNumberArray<N, T> >
+{
+  typedef typename ValueType<T>::type type;
+};
+
+} // namespace MetaPhysicL
+
+
+
+namespace std {
+
+using MetaPhysicL::SemiDynamicNumberArray;
+using MetaPhysicL::CompareTypes;
+
+// Entries past the size stay implicit zeros when f(0) == 0; otherwise
+// every entry is filled in
+#define SemiDynamicNumberArray_std_unary(funcname) \
+template <std::size_t N, typename T> \
+inline \
+SemiDynamicNumberArray<N, T> \
+funcname (SemiDynamicNumberArray<N, T> a) \
+{ \
+  if (!(std::funcname(T(0)) == T(0))) \
+    a.resize(N); \
+ \
+  T * data = a.raw_data(); \
+  for (std::size_t i=0; i != a.size(); ++i) \
+    data[i] = std::funcname(data[i]); \
+ \
+  return a; \
+}
+
+
+#define SemiDynamicNumberArray_fl_unary(funcname) \
+SemiDynamicNumberArray_std_unary(funcname##f) \
+SemiDynamicNumberArray_std_unary(funcname##l)
+
+
+#define SemiDynamicNumberArray_stdfl_unary(funcname) \
+SemiDynamicNumberArray_std_unary(funcname) \
+SemiDynamicNumberArray_fl_unary(funcname)
+
+
+#define SemiDynamicNumberArray_std_binary_abab(funcname, atype, btype, abtypes, aarg, barg, asize, bsize) \
+template <std::size_t N, typename T, typename T2> \
+inline \
+typename CompareTypes<abtypes>::supertype \
+funcname (const atype& a, const btype& b) \
+{ \
+  typedef typename CompareTypes<abtypes>::supertype TS; \
+  typedef typename TS::value_type VS; \
+  TS returnval; \
+ \
+  if (!(std::funcname(VS(0), VS(0)) == VS(0))) \
+    returnval.resize(N); \
+  else \
+    returnval.resize(std::max(std::size_t(asize), std::size_t(bsize))); \
+ \
+  for (std::size_t i=0; i != returnval.size(); ++i) \
+    returnval.raw_at(i) = std::funcname(aarg, barg); \
+ \
+  return returnval; \
+}
+
+
+// Operands of one type need an exact match, to beat the std::max
+// and std::min templates
+#define SemiDynamicNumberArray_std_binary_aa(funcname, atype) \
+template <std::size_t N, typename T> \
+inline \
+atype \
+funcname (const atype& a, const atype& b) \
+{ \
+  atype returnval; \
+ \
+  if (!(std::funcname(T(0), T(0)) == T(0))) \
+    returnval.resize(N); \
+  else \
+    returnval.resize(std::max(a.size(), b.size())); \
+ \
+  for (std::size_t i=0; i != returnval.size(); ++i) \
+    returnval.raw_at(i) = std::funcname(a[i], b[i]); \
+ \
+  return returnval; \
+}
+
+
+#define SemiDynamicNumberArray_std_binary(funcname) \
+SemiDynamicNumberArray_std_binary_abab(funcname, SemiDynamicNumberArray<N MacroComma T>, SemiDynamicNumberArray<N MacroComma T2>, \
+                                       SemiDynamicNumberArray<N MacroComma T> MacroComma SemiDynamicNumberArray<N MacroComma T2>, \
+                                       VS(a[i]), VS(b[i]), a.size(), b.size()) \
+SemiDynamicNumberArray_std_binary_abab(funcname,                                        T , SemiDynamicNumberArray<N MacroComma T2>, \
+                                       SemiDynamicNumberArray<N MacroComma T2> MacroComma T, \
+                                       VS(a), VS(b[i]), N, b.size()) \
+SemiDynamicNumberArray_std_binary_abab(funcname, SemiDynamicNumberArray<N MacroComma T>,                                        T2 , \
+                                       SemiDynamicNumberArray<N MacroComma T> MacroComma T2, \
+                                       VS(a[i]), VS(b), a.size(), N) \
+SemiDynamicNumberArray_std_binary_aa(funcname, SemiDynamicNumberArray<N MacroComma T>)
+
+
+#define SemiDynamicNumberArray_fl_binary(funcname) \
+SemiDynamicNumberArray_std_binary(funcname##f) \
+SemiDynamicNumberArray_std_binary(funcname##l)
+
+
+#define SemiDynamicNumberArray_stdfl_binary(funcname) \
+SemiDynamicNumberArray_std_binary(funcname) \
+SemiDynamicNumberArray_fl_binary(funcname)
+
+
+// pow classifies a scalar exponent once for the whole array
+SemiDynamicNumberArray_std_binary_abab(pow, SemiDynamicNumberArray<N MacroComma T>, SemiDynamicNumberArray<N MacroComma T2>,
+                                       SemiDynamicNumberArray<N MacroComma T> MacroComma SemiDynamicNumberArray<N MacroComma T2>,
+                                       VS(a[i]), VS(b[i]), a.size(), b.size())
+SemiDynamicNumberArray_std_binary_abab(pow,                                        T , SemiDynamicNumberArray<N MacroComma T2>,
+                                       SemiDynamicNumberArray<N MacroComma T2> MacroComma T,
+                                       VS(a), VS(b[i]), N, b.size())
+SemiDynamicNumberArray_std_binary_aa(pow, SemiDynamicNumberArray<N MacroComma T>)
+
+// pow(0,0) is 1, so every entry is stored
+template <std::size_t N, typename T, typename T2>
+inline
+typename CompareTypes<SemiDynamicNumberArray<N,T>, T2>::supertype
+pow (const SemiDynamicNumberArray<N,T>& a, const T2& b)
+{
+  typedef typename CompareTypes<SemiDynamicNumberArray<N,T>, T2>::supertype TS;
+  typedef typename TS::value_type VS;
+  TS returnval;
+  returnval.resize(N);
+
+  const MetaPhysicL::FixedExponentPow<VS> powb(b);
+  for (std::size_t i=0; i != N; ++i)
+    returnval.raw_at(i) = powb(VS(a[i]));
+
+  return returnval;
+}
+
+SemiDynamicNumberArray_std_unary(exp)
+SemiDynamicNumberArray_std_unary(log)
+SemiDynamicNumberArray_std_unary(log10)
+SemiDynamicNumberArray_std_unary(sin)
+SemiDynamicNumberArray_std_unary(cos)
+SemiDynamicNumberArray_std_unary(tan)
+SemiDynamicNumberArray_std_unary(asin)
+SemiDynamicNumberArray_std_unary(acos)
+SemiDynamicNumberArray_std_unary(atan)
+SemiDynamicNumberArray_std_binary(atan2)
+SemiDynamicNumberArray_std_unary(sinh)
+SemiDynamicNumberArray_std_unary(cosh)
+SemiDynamicNumberArray_std_unary(tanh)
+SemiDynamicNumberArray_std_unary(sqrt)
+SemiDynamicNumberArray_std_unary(abs)
+SemiDynamicNumberArray_std_unary(fabs)
+SemiDynamicNumberArray_std_binary(max)
+SemiDynamicNumberArray_std_binary(min)
+SemiDynamicNumberArray_std_unary(ceil)
+SemiDynamicNumberArray_std_unary(floor)
+SemiDynamicNumberArray_std_binary(fmod)
+
+#if __cplusplus >= 201103L
+SemiDynamicNumberArray_std_unary(llabs)
+SemiDynamicNumberArray_std_unary(imaxabs)
+SemiDynamicNumberArray_fl_unary(fabs)
+SemiDynamicNumberArray_fl_unary(exp)
+SemiDynamicNumberArray_stdfl_unary(exp2)
+SemiDynamicNumberArray_stdfl_unary(expm1)
+SemiDynamicNumberArray_fl_unary(log)
+SemiDynamicNumberArray_fl_unary(log10)
+SemiDynamicNumberArray_stdfl_unary(log2)
+SemiDynamicNumberArray_stdfl_unary(log1p)
+SemiDynamicNumberArray_fl_unary(sqrt)
+SemiDynamicNumberArray_stdfl_unary(cbrt)
+SemiDynamicNumberArray_fl_unary(sin)
+SemiDynamicNumberArray_fl_unary(cos)
+SemiDynamicNumberArray_fl_unary(tan)
+SemiDynamicNumberArray_fl_unary(asin)
+SemiDynamicNumberArray_fl_unary(acos)
+SemiDynamicNumberArray_fl_unary(atan)
+SemiDynamicNumberArray_fl_unary(sinh)
+SemiDynamicNumberArray_fl_unary(cosh)
+SemiDynamicNumberArray_fl_unary(tanh)
+SemiDynamicNumberArray_stdfl_unary(asinh)
+SemiDynamicNumberArray_stdfl_unary(acosh)
+SemiDynamicNumberArray_stdfl_unary(atanh)
+SemiDynamicNumberArray_stdfl_unary(erf)
+SemiDynamicNumberArray_stdfl_unary(erfc)
+SemiDynamicNumberArray_stdfl_unary(tgamma)
+SemiDynamicNumberArray_stdfl_unary(lgamma)
+SemiDynamicNumberArray_fl_unary(ceil)
+SemiDynamicNumberArray_fl_unary(floor)
+SemiDynamicNumberArray_stdfl_unary(trunc)
+SemiDynamicNumberArray_stdfl_unary(round)
+SemiDynamicNumberArray_stdfl_unary(nearbyint)
+SemiDynamicNumberArray_stdfl_unary(rint)
+
+SemiDynamicNumberArray_fl_binary(pow)
+SemiDynamicNumberArray_fl_binary(fmod)
+SemiDynamicNumberArray_stdfl_binary(remainder)
+SemiDynamicNumberArray_stdfl_binary(fmax)
+SemiDynamicNumberArray_stdfl_binary(fmin)
+SemiDynamicNumberArray_stdfl_binary(fdim)
+SemiDynamicNumberArray_stdfl_binary(hypot)
+SemiDynamicNumberArray_fl_binary(atan2)
+#endif // __cplusplus >= 201103L
+
+
+template <std::size_t N, typename T>
+class numeric_limits<SemiDynamicNumberArray<N, T> > :
+  public MetaPhysicL::raw_numeric_limits<SemiDynamicNumberArray<N, T>, T> {};
+
+} // namespace std
+
+
+#endif // METAPHYSICL_SEMIDYNAMICNUMBERARRAY_H
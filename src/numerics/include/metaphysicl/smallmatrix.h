@@ -0,0 +1,438 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// MetaPhysicL - A metaprogramming library for physics calculations
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+//
+// $Id$
+//
+//--------------------------------------------------------------------------
+
+#ifndef METAPHYSICL_SMALLMATRIX_H
+#define METAPHYSICL_SMALLMATRIX_H
+
+#include <cmath>
+
+#include "metaphysicl/metaprogramming.h" // for Unroll
+#include "metaphysicl/numbervector.h"
+
+namespace MetaPhysicL {
+
+// Dense linear algebra on small NumberVector<M, NumberVector<N,T> >
+// matrices, stored by rows.  Determinants, adjugates, inverses and
+// solves use closed forms, for N <= 4 only.  Including
+// dualsmallmatrix.h adds overloads for DualNumber entries which apply
+// the analytic derivative of each operation rather than
+// differentiating through every scalar operation.
+
+template <std::size_t N>
+struct SmallMatrix
+{
+  static_assert(N >= 1 && N <= 4,
+                "Closed-form determinants are only provided for N <= 4");
+};
+
+template <>
+struct SmallMatrix<1>
+{
+  template <typename T>
+  static T determinant(const NumberVector<1, NumberVector<1, T> >& a)
+    { return a[0][0]; }
+
+  template <typename T>
+  static NumberVector<1, NumberVector<1, T> >
+  adjugate(const NumberVector<1, NumberVector<1, T> >&)
+    { return NumberVector<1, NumberVector<1, T> >(1); }
+};
+
+template <>
+struct SmallMatrix<2>
+{
+  template <typename T>
+  static T determinant(const NumberVector<2, NumberVector<2, T> >& a)
+    { return a[0][0] * a[1][1] - a[0][1] * a[1][0]; }
+
+  template <typename T>
+  static NumberVector<2, NumberVector<2, T> >
+  adjugate(const NumberVector<2, NumberVector<2, T> >& a)
+  {
+    NumberVector<2, NumberVector<2, T> > b;
+    b[0][0] =  a[1][1]; b[0][1] = -a[0][1];
+    b[1][0] = -a[1][0]; b[1][1] =  a[0][0];
+    return b;
+  }
+};
+
+template <>
+struct SmallMatrix<3>
+{
+  template <typename T>
+  static T determinant(const NumberVector<3, NumberVector<3, T> >& a)
+  {
+    return a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1]) +
+           a[0][1] * (a[1][2] * a[2][0] - a[1][0] * a[2][2]) +
+           a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+  }
+
+  template <typename T>
+  static NumberVector<3, NumberVector<3, T> >
+  adjugate(const NumberVector<3, NumberVector<3, T> >& a)
+  {
+    NumberVector<3, NumberVector<3, T> > b;
+    b[0][0] = a[1][1] * a[2][2] - a[1][2] * a[2][1];
+    b[0][1] = a[0][2] * a[2][1] - a[0][1] * a[2][2];
+    b[0][2] = a[0][1] * a[1][2] - a[0][2] * a[1][1];
+    b[1][0] = a[1][2] * a[2][0] - a[1][0] * a[2][2];
+    b[1][1] = a[0][0] * a[2][2] - a[0][2] * a[2][0];
+    b[1][2] = a[0][2] * a[1][0] - a[0][0] * a[1][2];
+    b[2][0] = a[1][0] * a[2][1] - a[1][1] * a[2][0];
+    b[2][1] = a[0][1] * a[2][0] - a[0][0] * a[2][1];
+    b[2][2] = a[0][0] * a[1][1] - a[0][1] * a[1][0];
+    return b;
+  }
+};
+
+// The 4x4 forms share the 2x2 minors of the top and bottom row pairs
+template <>
+struct SmallMatrix<4>
+{
+  template <typename T>
+  static T determinant(const NumberVector<4, NumberVector<4, T> >& a)
+  {
+    const T s0 = a[0][0] * a[1][1] - a[1][0] * a[0][1];
+    const T s1 = a[0][0] * a[1][2] - a[1][0] * a[0][2];
+    const T s2 = a[0][0] * a[1][3] - a[1][0] * a[0][3];
+    const T s3 = a[0][1] * a[1][2] - a[1][1] * a[0][2];
+    const T s4 = a[0][1] * a[1][3] - a[1][1] * a[0][3];
+    const T s5 = a[0][2] * a[1][3] - a[1][2] * a[0][3];
+
+    const T c5 = a[2][2] * a[3][3] - a[3][2] * a[2][3];
+    const T c4 = a[2][1] * a[3][3] - a[3][1] * a[2][3];
+    const T c3 = a[2][1] * a[3][2] - a[3][1] * a[2][2];
+    const T c2 = a[2][0] * a[3][3] - a[3][0] * a[2][3];
+    const T c1 = a[2][0] * a[3][2] - a[3][0] * a[2][2];
+    const T c0 = a[2][0] * a[3][1] - a[3][0] * a[2][1];
+
+    return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+  }
+
+  template <typename T>
+  static NumberVector<4, NumberVector<4, T> >
+  adjugate(const NumberVector<4, NumberVector<4, T> >& a)
+  {
+    const T s0 = a[0][0] * a[1][1] - a[1][0] * a[0][1];
+    const T s1 = a[0][0] * a[1][2] - a[1][0] * a[0][2];
+    const T s2 = a[0][0] * a[1][3] - a[1][0] * a[0][3];
+    const T s3 = a[0][1] * a[1][2] - a[1][1] * a[0][2];
+    const T s4 = a[0][1] * a[1][3] - a[1][1] * a[0][3];
+    const T s5 = a[0][2] * a[1][3] - a[1][2] * a[0][3];
+
+    const T c5 = a[2][2] * a[3][3] - a[3][2] * a[2][3];
+    const T c4 = a[2][1] * a[3][3] - a[3][1] * a[2][3];
+    const T c3 = a[2][1] * a[3][2] - a[3][1] * a[2][2];
+    const T c2 = a[2][0] * a[3][3] - a[3][0] * a[2][3];
+    const T c1 = a[2][0] * a[3][2] - a[3][0] * a[2][2];
+    const T c0 = a[2][0] * a[3][1] - a[3][0] * a[2][1];
+
+    NumberVector<4, NumberVector<4, T> > b;
+    b[0][0] =  a[1][1] * c5 - a[1][2] * c4 + a[1][3] * c3;
+    b[0][1] = -a[0][1] * c5 + a[0][2] * c4 - a[0][3] * c3;
+    b[0][2] =  a[3][1] * s5 - a[3][2] * s4 + a[3][3] * s3;
+    b[0][3] = -a[2][1] * s5 + a[2][2] * s4 - a[2][3] * s3;
+
+    b[1][0] = -a[1][0] * c5 + a[1][2] * c2 - a[1][3] * c1;
+    b[1][1] =  a[0][0] * c5 - a[0][2] * c2 + a[0][3] * c1;
+    b[1][2] = -a[3][0] * s5 + a[3][2] * s2 - a[3][3] * s1;
+    b[1][3] =  a[2][0] * s5 - a[2][2] * s2 + a[2][3] * s1;
+
+    b[2][0] =  a[1][0] * c4 - a[1][1] * c2 + a[1][3] * c0;
+    b[2][1] = -a[0][0] * c4 + a[0][1] * c2 - a[0][3] * c0;
+    b[2][2] =  a[3][0] * s4 - a[3][1] * s2 + a[3][3] * s0;
+    b[2][3] = -a[2][0] * s4 + a[2][1] * s2 - a[2][3] * s0;
+
+    b[3][0] = -a[1][0] * c3 + a[1][1] * c1 - a[1][2] * c0;
+    b[3][1] =  a[0][0] * c3 - a[0][1] * c1 + a[0][2] * c0;
+    b[3][2] = -a[3][0] * s3 + a[3][1] * s1 - a[3][2] * s0;
+    b[3][3] =  a[2][0] * s3 - a[2][1] * s1 + a[2][2] * s0;
+    return b;
+  }
+};
+
+
+template <std::size_t M, std::size_t K, std::size_t N, typename T, typename T2>
+inline
+NumberVector<M, NumberVector<N, typename SymmetricMultipliesType<T,T2>::supertype> >
+matmul(const NumberVector<M, NumberVector<K, T> >& a,
+       const NumberVector<K, NumberVector<N, T2> >& b)
+{
+  NumberVector<M, NumberVector<N, typename SymmetricMultipliesType<T,T2>::supertype> >
+    returnval;
+
+  Unroll<M>::apply([&](std::size_t i){
+    Unroll<N>::apply([&](std::size_t j){
+      returnval[i][j] = a[i][0] * b[0][j];
+      Unroll<K-1>::apply([&](std::size_t k){ returnval[i][j] += a[i][k+1] * b[k+1][j]; });
+    });
+  });
+
+  return returnval;
+}
+
+
+template <std::size_t M, std::size_t K, typename T, typename T2>
+inline
+NumberVector<M, typename SymmetricMultipliesType<T,T2>::supertype>
+matmul(const NumberVector<M, NumberVector<K, T> >& a,
+       const NumberVector<K, T2>& x)
+{
+  NumberVector<M, typename SymmetricMultipliesType<T,T2>::supertype> returnval;
+
+  Unroll<M>::apply([&](std::size_t i){ returnval[i] = a[i].dot(x); });
+
+  return returnval;
+}
+
+
+template <std::size_t N, typename T>
+inline
+T determinant(const NumberVector<N, NumberVector<N, T> >& a)
+{
+  return SmallMatrix<N>::determinant(a);
+}
+
+
+template <std::size_t N, typename T>
+inline
+NumberVector<N, NumberVector<N, T> >
+adjugate(const NumberVector<N, NumberVector<N, T> >& a)
+{
+  return SmallMatrix<N>::adjugate(a);
+}
+
+
+// A singular matrix gives non-finite entries, as scalar division
+// would
+template <std::size_t N, typename T>
+inline
+NumberVector<N, NumberVector<N, T> >
+inverse(const NumberVector<N, NumberVector<N, T> >& a)
+{
+  NumberVector<N, NumberVector<N, T> > returnval = adjugate(a);
+
+  // Expanding along the first row reuses the adjugate
+  T det = a[0][0] * returnval[0][0];
+  Unroll<N-1>::apply([&](std::size_t j){ det += a[0][j+1] * returnval[j+1][0]; });
+
+  Unroll<N>::apply([&](std::size_t i){ returnval[i] /= det; });
+
+  return returnval;
+}
+
+
+template <std::size_t N, typename T, typename T2>
+inline
+NumberVector<N, typename CompareTypes<T,T2>::supertype>
+solve(const NumberVector<N, NumberVector<N, T> >& a,
+      const NumberVector<N, T2>& b)
+{
+  return matmul(inverse(a), b);
+}
+
+
+// Eigenvalues and unit eigenvectors of a symmetric matrix by cyclic
+// Jacobi rotations, in ascending order of eigenvalue.  eigenvectors[i]
+// belongs to eigenvalues[i].  Only the upper triangle of a is read.
+template <std::size_t N, typename T>
+inline
+void
+symmetric_eigensystem(const NumberVector<N, NumberVector<N, T> >& a,
+                      NumberVector<N, T>& eigenvalues,
+                      NumberVector<N, NumberVector<N, T> >& eigenvectors)
+{
+  NumberVector<N, NumberVector<N, T> > w;
+  for (std::size_t i=0; i != N; ++i)
+    for (std::size_t j=i; j != N; ++j)
+      w[i][j] = w[j][i] = a[i][j];
+
+  // Columns of v accumulate the rotations
+  NumberVector<N, NumberVector<N, T> > v =
+    NumberVector<N, T>::identity();
+
+  for (unsigned int sweep = 0; sweep != 50; ++sweep)
+    {
+      bool diagonal = true;
+
+      for (std::size_t p=0; p != N; ++p)
+        for (std::size_t q=p+1; q != N; ++q)
+          {
+            if (w[p][q] == 0)
+              continue;
+
+            // Off-diagonal entries lost in roundoff are dropped
+            const T g = 100 * std::abs(w[p][q]);
+            if (std::abs(w[p][p]) + g == std::abs(w[p][p]) &&
+                std::abs(w[q][q]) + g == std::abs(w[q][q]))
+              {
+                w[p][q] = w[q][p] = 0;
+                continue;
+              }
+
+            diagonal = false;
+
+            const T theta = (w[q][q] - w[p][p]) / (2 * w[p][q]);
+            T t = 1 / (std::abs(theta) + std::sqrt(theta * theta + 1));
+            if (theta < 0)
+              t = -t;
+            const T c = 1 / std::sqrt(t * t + 1), s = t * c;
+
+            for (std::size_t k=0; k != N; ++k)
+              {
+                const T wkp = w[k][p], wkq = w[k][q];
+                w[k][p] = c * wkp - s * wkq;
+                w[k][q] = s * wkp + c * wkq;
+              }
+            for (std::size_t k=0; k != N; ++k)
+              {
+                const T wpk = w[p][k], wqk = w[q][k];
+                w[p][k] = c * wpk - s * wqk;
+                w[q][k] = s * wpk + c * wqk;
+              }
+            for (std::size_t k=0; k != N; ++k)
+              {
+                const T vkp = v[k][p], vkq = v[k][q];
+                v[k][p] = c * vkp - s * vkq;
+                v[k][q] = s * vkp + c * vkq;
+              }
+            w[p][q] = w[q][p] = 0;
+          }
+
+      if (diagonal)
+        break;
+    }
+
+  for (std::size_t i=0; i != N; ++i)
+    eigenvalues[i] = w[i][i];
+  eigenvectors = transpose(v);
+
+  // Selection sort is plenty for N this small
+  for (std::size_t i=0; i != N; ++i)
+    {
+      std::size_t smallest = i;
+      for (std::size_t j=i+1; j != N; ++j)
+        if (eigenvalues[j] < eigenvalues[smallest])
+          smallest = j;
+      if (smallest != i)
+        {
+          std::swap(eigenvalues[i], eigenvalues[smallest]);
+          std::swap(eigenvectors[i], eigenvectors[smallest]);
+        }
+    }
+}
+
+
+// Eigenvalues of a symmetric matrix in ascending order, by Jacobi
+// rotations in general and in closed form for N <= 3
+template <std::size_t N>
+struct SymmetricEigenvalues
+{
+  template <typename T>
+  static NumberVector<N, T> value(const NumberVector<N, NumberVector<N, T> >& a)
+  {
+    NumberVector<N, T> eigenvalues;
+    NumberVector<N, NumberVector<N, T> > eigenvectors;
+    symmetric_eigensystem(a, eigenvalues, eigenvectors);
+    return eigenvalues;
+  }
+};
+
+template <>
+struct SymmetricEigenvalues<1>
+{
+  template <typename T>
+  static NumberVector<1, T> value(const NumberVector<1, NumberVector<1, T> >& a)
+    { return a[0]; }
+};
+
+template <>
+struct SymmetricEigenvalues<2>
+{
+  template <typename T>
+  static NumberVector<2, T> value(const NumberVector<2, NumberVector<2, T> >& a)
+  {
+    const T mean = (a[0][0] + a[1][1]) / 2,
+            half_diff = (a[0][0] - a[1][1]) / 2;
+    const T radius = std::sqrt(half_diff * half_diff + a[0][1] * a[0][1]);
+
+    NumberVector<2, T> returnval;
+    returnval[0] = mean - radius;
+    returnval[1] = mean + radius;
+    return returnval;
+  }
+};
+
+// The trigonometric solution of the characteristic cubic, after
+// shifting by the mean eigenvalue and scaling to unit spread
+template <>
+struct SymmetricEigenvalues<3>
+{
+  template <typename T>
+  static NumberVector<3, T> value(const NumberVector<3, NumberVector<3, T> >& a)
+  {
+    const T mean = (a[0][0] + a[1][1] + a[2][2]) / 3;
+    const T d0 = a[0][0] - mean, d1 = a[1][1] - mean, d2 = a[2][2] - mean;
+    const T offdiag = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+    const T spread2 = (d0 * d0 + d1 * d1 + d2 * d2 + 2 * offdiag) / 6;
+
+    if (spread2 == 0)
+      return NumberVector<3, T>(mean);
+
+    const T spread = std::sqrt(spread2);
+
+    // det((A - mean I)/spread)/2, clamped against roundoff
+    T r = (d0 * (d1 * d2 - a[1][2] * a[1][2]) -
+           a[0][1] * (a[0][1] * d2 - a[1][2] * a[0][2]) +
+           a[0][2] * (a[0][1] * a[1][2] - d1 * a[0][2])) /
+          (2 * spread2 * spread);
+    if (r < -1)
+      r = -1;
+    else if (r > 1)
+      r = 1;
+
+    const T phi = std::acos(r) / 3;
+    NumberVector<3, T> returnval;
+    returnval[2] = mean + 2 * spread * std::cos(phi);
+    returnval[0] = mean + 2 * spread * std::cos(phi + 2.0943951023931954923);
+    returnval[1] = 3 * mean - returnval[0] - returnval[2];
+    return returnval;
+  }
+};
+
+// Only the upper triangle of a is read
+template <std::size_t N, typename T>
+inline
+NumberVector<N, T>
+symmetric_eigenvalues(const NumberVector<N, NumberVector<N, T> >& a)
+{
+  return SymmetricEigenvalues<N>::value(a);
+}
+
+} // namespace MetaPhysicL
+
+#endif // METAPHYSICL_SMALLMATRIX_H
@@ -0,0 +1,349 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// MetaPhysicL - A metaprogramming library for physics calculations
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+//
+// $Id$
+//
+//--------------------------------------------------------------------------
+
+
+#ifndef METAPHYSICL_SORTEDSET_H
+#define METAPHYSICL_SORTEDSET_H
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+
+#include "metaphysicl/compare_types.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace MetaPhysicL {
+
+// Kernels on sorted ranges of unique indices, as used for sparsity
+// patterns.  Iterators must point into contiguous storage.
+//
+// Walking two ranges together with an if/else per step mispredicts
+// about half the time on irregular patterns.  These kernels instead
+// advance each range by the result of a comparison, which compilers
+// turn into conditional moves, and only branch where the work done
+// differs.  Counting compares whole blocks of indices at once, with
+// SSE2 for unsigned int and unsigned short indices.  When one range
+// is much longer than the other, the kernels binary search the longer
+// one instead of walking it.
+
+namespace SortedSet {
+
+// Ranges whose lengths differ by at least this factor are searched
+// rather than walked together
+static const std::size_t search_ratio = 16;
+
+// Calls f(i, j) for each pair of positions with a[i] == b[j], in
+// order
+template <typename It, typename It2, typename Functor>
+inline
+void
+for_each_common (It a, It a_end, It2 b, It2 b_end, Functor& f)
+{
+  const std::size_t na = a_end - a, nb = b_end - b;
+
+  if (na > search_ratio * nb)
+    {
+      It a_it = a;
+      for (It2 b_it = b; b_it != b_end; ++b_it)
+        {
+          a_it = std::lower_bound(a_it, a_end, *b_it);
+          if (a_it == a_end)
+            return;
+          if (*a_it == *b_it)
+            f(std::size_t(a_it - a), std::size_t(b_it - b));
+        }
+      return;
+    }
+
+  if (nb > search_ratio * na)
+    {
+      It2 b_it = b;
+      for (It a_it = a; a_it != a_end; ++a_it)
+        {
+          b_it = std::lower_bound(b_it, b_end, *a_it);
+          if (b_it == b_end)
+            return;
+          if (*b_it == *a_it)
+            f(std::size_t(a_it - a), std::size_t(b_it - b));
+        }
+      return;
+    }
+
+  std::size_t i = 0, j = 0;
+  while (i != na && j != nb)
+    {
+      const typename std::iterator_traits<It>::value_type ai = a[i];
+      const typename std::iterator_traits<It2>::value_type bj = b[j];
+      if (ai == bj)
+        f(i, j);
+      i += !(bj < ai);
+      j += !(ai < bj);
+    }
+}
+
+
+// Counts the indices common to a[i, na) and b[j, nb) a block at a
+// time: each block of one range is compared against a block of the
+// other all at once, then whichever block ends first (or both) is
+// stepped past.  Stops when either range has less than a block left,
+// leaving i and j there; every match for an index before i or j has
+// been counted.
+
+template <typename I, typename I2>
+struct BlockIntersection
+{
+  static const std::size_t block_size = 4;
+
+  static std::size_t count (const I* a, std::size_t na,
+                            const I2* b, std::size_t nb,
+                            std::size_t& i, std::size_t& j)
+  {
+    std::size_t matches = 0;
+    while (i + block_size <= na && j + block_size <= nb)
+      {
+        for (std::size_t k = 0; k != block_size; ++k)
+          for (std::size_t l = 0; l != block_size; ++l)
+            matches += (a[i+k] == b[j+l]);
+
+        const I a_last = a[i+block_size-1];
+        const I2 b_last = b[j+block_size-1];
+        i += !(b_last < a_last) * block_size;
+        j += !(a_last < b_last) * block_size;
+      }
+    return matches;
+  }
+};
+
+#ifdef __SSE2__
+
+inline unsigned int popcount (unsigned int x)
+{
+  x = x - ((x >> 1) & 0x55555555u);
+  x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+  return (((x + (x >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24;
+}
+
+// Four 32-bit indices at a time, against each rotation of the other
+// block
+template <>
+struct BlockIntersection<unsigned int, unsigned int>
+{
+  static std::size_t count (const unsigned int* a, std::size_t na,
+                            const unsigned int* b, std::size_t nb,
+                            std::size_t& i, std::size_t& j)
+  {
+    std::size_t matches = 0;
+    while (i + 4 <= na && j + 4 <= nb)
+      {
+        const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a+i));
+        const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b+j));
+
+        __m128i eq = _mm_cmpeq_epi32(va, vb);
+        eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0,3,2,1))));
+        eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1,0,3,2))));
+        eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2,1,0,3))));
+        matches += popcount(_mm_movemask_ps(_mm_castsi128_ps(eq)));
+
+        const unsigned int a_last = a[i+3], b_last = b[j+3];
+        i += (a_last <= b_last) * 4;
+        j += (b_last <= a_last) * 4;
+      }
+    return matches;
+  }
+};
+
+// Eight 16-bit indices at a time, against each rotation of the other
+// block
+template <>
+struct BlockIntersection<unsigned short, unsigned short>
+{
+  static std::size_t count (const unsigned short* a, std::size_t na,
+                            const unsigned short* b, std::size_t nb,
+                            std::size_t& i, std::size_t& j)
+  {
+    std::size_t matches = 0;
+    while (i + 8 <= na && j + 8 <= nb)
+      {
+        const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a+i));
+        const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b+j));
+
+#define METAPHYSICL_ROTATED_EQ(k) \
+  _mm_cmpeq_epi16(va, _mm_or_si128(_mm_srli_si128(vb, 2*k), \
+                                   _mm_slli_si128(vb, 16-2*k)))
+        __m128i eq = _mm_cmpeq_epi16(va, vb);
+        eq = _mm_or_si128(eq, METAPHYSICL_ROTATED_EQ(1));
+        eq = _mm_or_si128(eq, METAPHYSICL_ROTATED_EQ(2));
+        eq = _mm_or_si128(eq, METAPHYSICL_ROTATED_EQ(3));
+        eq = _mm_or_si128(eq, METAPHYSICL_ROTATED_EQ(4));
+        eq = _mm_or_si128(eq, METAPHYSICL_ROTATED_EQ(5));
+        eq = _mm_or_si128(eq, METAPHYSICL_ROTATED_EQ(6));
+        eq = _mm_or_si128(eq, METAPHYSICL_ROTATED_EQ(7));
+#undef METAPHYSICL_ROTATED_EQ
+
+        // Two mask bits per 16-bit lane
+        matches += popcount(_mm_movemask_epi8(eq)) / 2;
+
+        const unsigned short a_last = a[i+7], b_last = b[j+7];
+        i += (a_last <= b_last) * 8;
+        j += (b_last <= a_last) * 8;
+      }
+    return matches;
+  }
+};
+
+#endif // __SSE2__
+
+
+struct CountFunctor
+{
+  CountFunctor() : count(0) {}
+  void operator() (std::size_t, std::size_t) { ++count; }
+  std::size_t count;
+};
+
+// The number of indices in both ranges
+template <typename It, typename It2>
+inline
+std::size_t
+intersection_size (It a, It a_end, It2 b, It2 b_end)
+{
+  const std::size_t na = a_end - a, nb = b_end - b;
+
+  if (na > search_ratio * nb || nb > search_ratio * na)
+    {
+      CountFunctor counter;
+      for_each_common(a, a_end, b, b_end, counter);
+      return counter.count;
+    }
+
+  std::size_t i = 0, j = 0, count = 0;
+  if (na && nb)
+    count = BlockIntersection
+      <typename std::iterator_traits<It>::value_type,
+       typename std::iterator_traits<It2>::value_type>::count
+        (&*a, na, &*b, nb, i, j);
+
+  // Every match for an index before i or j has been counted; finish
+  // the rest one entry at a time
+  while (i != na && j != nb)
+    {
+      const typename std::iterator_traits<It>::value_type ai = a[i];
+      const typename std::iterator_traits<It2>::value_type bj = b[j];
+      const bool a_first = !(bj < ai), b_first = !(ai < bj);
+      count += a_first & b_first;
+      i += a_first;
+      j += b_first;
+    }
+  return count;
+}
+
+
+// The number of indices in either range
+template <typename It, typename It2>
+inline
+std::size_t
+union_size (It a, It a_end, It2 b, It2 b_end)
+{
+  return std::size_t(a_end - a) + std::size_t(b_end - b) -
+    intersection_size(a, a_end, b, b_end);
+}
+
+
+template <typename It, typename DataIt>
+struct CompactFunctor
+{
+  CompactFunctor(It a_in, DataIt data_in) : a(a_in), data(data_in), kept(0) {}
+
+  void operator() (std::size_t i, std::size_t)
+  {
+    if (kept != i)
+      {
+        using std::swap;
+        a[kept] = a[i];
+        swap(data[kept], data[i]);
+      }
+    ++kept;
+  }
+
+  It a;
+  DataIt data;
+  std::size_t kept;
+};
+
+// Removes from [a, a_end) every index not in [b, b_end), moving the
+// entries of the parallel range starting at data along with them.
+// Returns the number of indices kept; data past that is left in an
+// unspecified (but valid) state.
+template <typename It, typename It2, typename DataIt>
+inline
+std::size_t
+intersect_in_place (It a, It a_end, It2 b, It2 b_end, DataIt data)
+{
+  using std::swap;
+
+  const std::size_t na = a_end - a, nb = b_end - b;
+
+  if (na > search_ratio * nb || nb > search_ratio * na)
+    {
+      CompactFunctor<It, DataIt> compactor(a, data);
+      for_each_common(a, a_end, b, b_end, compactor);
+      return compactor.kept;
+    }
+
+  // Every index is moved down unconditionally; one which isn't kept
+  // is overwritten by the next one which is.  Builtin data is moved
+  // the same way, while other data is only moved when kept.
+  const bool move_always =
+    BuiltinTraits<typename std::iterator_traits<DataIt>::value_type>::value;
+
+  std::size_t i = 0, j = 0, kept = 0;
+  while (i != na && j != nb)
+    {
+      const typename std::iterator_traits<It>::value_type ai = a[i];
+      const typename std::iterator_traits<It2>::value_type bj = b[j];
+      const bool a_first = !(bj < ai), b_first = !(ai < bj);
+      const bool keep = a_first & b_first;
+      a[kept] = ai;
+      if (move_always)
+        data[kept] = data[i];
+      else if (keep && kept != i)
+        swap(data[kept], data[i]);
+      kept += keep;
+      i += a_first;
+      j += b_first;
+    }
+  return kept;
+}
+
+} // namespace SortedSet
+
+} // namespace MetaPhysicL
+
+#endif // METAPHYSICL_SORTEDSET_H
@@ -30,7 +30,12 @@
 #define METAPHYSICL_SPARSENUMBERUTILS_H
 
 #include <algorithm>
+#include <cstddef>
 #include <functional>
+#include <limits>
+#include <vector>
+
+#include <stdint.h>
 
 namespace MetaPhysicL {
 
@@ -158,6 +163,99 @@ binary_bind2nd (BinaryFunctor f, const Arg2 &b)
     Tout* _dataout;
   };
 
+
+  // Sets perm to the stable ordering of keys[0] through keys[n-1],
+  // so that keys[perm[0]], keys[perm[1]], ... are nondecreasing.
+  // Integer keys are radix sorted a byte at a time, skipping any
+  // byte which every key shares; other keys are merge sorted.
+  template <typename I, bool is_integer = std::numeric_limits<I>::is_integer>
+  struct SortedPermutation
+  {
+    struct KeyLess {
+      KeyLess(const I* k) : keys(k) {}
+      bool operator() (std::size_t a, std::size_t b) const
+        { return keys[a] < keys[b]; }
+      const I* keys;
+    };
+
+    static void build(const I* keys, std::size_t n,
+                      std::vector<std::size_t>& perm)
+    {
+      perm.resize(n);
+      for (std::size_t k = 0; k != n; ++k)
+        perm[k] = k;
+      std::stable_sort(perm.begin(), perm.end(), KeyLess(keys));
+    }
+  };
+
+  template <typename I>
+  struct SortedPermutation<I, true>
+  {
+    // Order-preserving map from signed or unsigned keys to unsigned
+    static uint64_t radix_key(I key) {
+      return std::numeric_limits<I>::is_signed ?
+        static_cast<uint64_t>(static_cast<int64_t>(key)) ^
+          (uint64_t(1) << (8 * sizeof(I) - 1)) :
+        static_cast<uint64_t>(key);
+    }
+
+    static void build(const I* keys, std::size_t n,
+                      std::vector<std::size_t>& perm)
+    {
+      perm.resize(n);
+      for (std::size_t k = 0; k != n; ++k)
+        perm[k] = k;
+
+      // Below this size a radix pass costs more than it saves
+      if (n < 64)
+        {
+          SortedPermutation<I, false>::build(keys, n, perm);
+          return;
+        }
+
+      const std::size_t n_bytes = sizeof(I) < 8 ? sizeof(I) : 8;
+      const uint64_t mask = (n_bytes == 8) ? ~uint64_t(0) :
+        ((uint64_t(1) << (8 * n_bytes)) - 1);
+
+      std::vector<std::size_t> counts(256 * n_bytes, 0);
+      for (std::size_t k = 0; k != n; ++k)
+        {
+          const uint64_t key = radix_key(keys[k]) & mask;
+          for (std::size_t b = 0; b != n_bytes; ++b)
+            ++counts[256 * b + ((key >> (8 * b)) & 0xff)];
+        }
+
+      std::vector<std::size_t> scratch(n);
+      for (std::size_t b = 0; b != n_bytes; ++b)
+        {
+          std::size_t * count = &counts[256 * b];
+
+          bool trivial = false;
+          for (std::size_t d = 0; d != 256; ++d)
+            trivial |= (count[d] == n);
+          if (trivial)
+            continue;
+
+          std::size_t offset = 0;
+          for (std::size_t d = 0; d != 256; ++d)
+            {
+              const std::size_t c = count[d];
+              count[d] = offset;
+              offset += c;
+            }
+
+          for (std::size_t k = 0; k != n; ++k)
+            {
+              const std::size_t p = perm[k];
+              const std::size_t d = ((radix_key(keys[p]) & mask) >> (8 * b)) & 0xff;
+              scratch[count[d]++] = p;
+            }
+
+          perm.swap(scratch);
+        }
+    }
+  };
+
 } // namespace std
 
 
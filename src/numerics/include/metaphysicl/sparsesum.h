@@ -0,0 +1,353 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// MetaPhysicL - A metaprogramming library for physics calculations
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+//
+// $Id$
+//
+//--------------------------------------------------------------------------
+
+#ifndef METAPHYSICL_SPARSESUM_H
+#define METAPHYSICL_SPARSESUM_H
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "metaphysicl/dualnumber_decl.h"
+#include "metaphysicl/dynamicsparsenumberbase_decl.h"
+
+namespace MetaPhysicL {
+
+// Sums of many dynamic sparse numbers, or of dual numbers with
+// dynamic sparse derivatives, as when accumulating an element
+// residual over quadrature points.  Adding k terms one at a time
+// merges sparsity patterns k-1 times, resizing the sum each time;
+// these instead merge all k patterns at once.  Terms whose indices
+// lie close together are scattered into a dense buffer; others are
+// walked together with a heap of their next indices.
+//
+// Terms are summed in order at each index, so a sequential sum gives
+// the same result as adding the terms one at a time.  A parallel sum
+// splits the terms between threads and adds the partial sums in a
+// tree, which changes the order of floating point additions.
+
+template <typename S>
+struct SparseSum
+{
+  // Sets result to the sum of *terms[0] through *terms[n_terms-1]
+  static void apply (const S* const* terms, std::size_t n_terms, S& result);
+
+private:
+  typedef typename S::index_value_type I;
+
+  // Terms are scattered into a dense buffer when their indices span
+  // less than this many times their total number of entries
+  static const std::size_t dense_ratio = 4;
+
+  // Fewer terms than this are otherwise added one at a time
+  static const std::size_t heap_min_terms = 8;
+  typedef std::pair<I, std::size_t> HeapEntry;
+
+  // Restores the min-heap property below heap[i]
+  static void sift_down (HeapEntry* heap, std::size_t n, std::size_t i)
+  {
+    const HeapEntry e = heap[i];
+    for (std::size_t c = 2*i+1; c < n; c = 2*i+1)
+      {
+        if (c+1 < n && heap[c+1] < heap[c])
+          ++c;
+        if (!(heap[c] < e))
+          break;
+        heap[i] = heap[c];
+        i = c;
+      }
+    heap[i] = e;
+  }
+};
+
+
+// Dual numbers sum their values in order and their derivatives with
+// one merge
+template <typename T, typename D>
+struct SparseSum<DualNumber<T,D> >
+{
+  static void apply (const DualNumber<T,D>* const* terms,
+                     std::size_t n_terms, DualNumber<T,D>& result)
+  {
+    std::vector<const D*> derivatives(n_terms);
+    T value = 0;
+    for (std::size_t t = 0; t != n_terms; ++t)
+      {
+        if (t)
+          value += terms[t]->value();
+        else
+          value = terms[t]->value();
+        derivatives[t] = &terms[t]->derivatives();
+      }
+    result.value() = value;
+    SparseSum<D>::apply(n_terms ? &derivatives[0] : NULL, n_terms,
+                        result.derivatives());
+  }
+};
+
+
+// The sum of the terms *first through *(last-1).  If parallel is set
+// and OpenMP is enabled, the terms are split between threads.
+template <typename It>
+typename std::iterator_traits<It>::value_type
+sparse_sum (It first, It last, bool parallel = false);
+
+
+// Gathers terms to be summed with one merge.  Terms are copied in,
+// or moved in C++11.
+template <typename S>
+class SparseAccumulator
+{
+public:
+  void add (const S& term) { _terms.push_back(term); }
+
+#if __cplusplus >= 201103L
+  void add (S&& term) { _terms.push_back(std::move(term)); }
+#endif
+
+  SparseAccumulator<S>& operator+= (const S& term)
+    { this->add(term); return *this; }
+
+  std::size_t size() const { return _terms.size(); }
+
+  void reserve (std::size_t n) { _terms.reserve(n); }
+
+  void clear () { _terms.clear(); }
+
+  // The sum of every term added since the last clear()
+  S sum (bool parallel = false) const
+    { return sparse_sum(_terms.begin(), _terms.end(), parallel); }
+
+private:
+  std::vector<S> _terms;
+};
+
+
+//
+// Member and function definitions
+//
+
+template <typename S>
+inline
+void
+SparseSum<S>::apply (const S* const* terms, std::size_t n_terms, S& result)
+{
+  typedef typename S::value_type T;
+  typedef typename SparsityStorage<I>::type index_vector;
+
+  if (!n_terms)
+    {
+      result = S();
+      return;
+    }
+
+  // Terms with equal patterns need no merge
+  bool equal = true;
+  for (std::size_t t = 1; equal && t != n_terms; ++t)
+    equal = equal_sparsity(terms[0]->nude_indices(), terms[t]->nude_indices());
+  if (equal)
+    {
+      result = *terms[0];
+      std::vector<T>& data = result.nude_data();
+      for (std::size_t t = 1; t != n_terms; ++t)
+        {
+          const std::vector<T>& term_data = terms[t]->nude_data();
+          for (std::size_t i = 0; i != data.size(); ++i)
+            data[i] += term_data[i];
+        }
+      return;
+    }
+
+  // Terms whose indices together span little more than their number
+  // of entries, as on one element, are scattered into a dense buffer
+  std::size_t n_entries = 0;
+  I lo = 0, hi = 0;
+  bool any = false;
+  for (std::size_t t = 0; t != n_terms; ++t)
+    {
+      const index_vector& term_indices = terms[t]->nude_indices();
+      if (term_indices.empty())
+        continue;
+      n_entries += term_indices.size();
+      const I front = term_indices[0], back = term_indices.back();
+      if (!any || front < lo)
+        lo = front;
+      if (!any || hi < back)
+        hi = back;
+      any = true;
+    }
+
+  if (any && std::size_t(hi - lo) < dense_ratio * n_entries)
+    {
+      const std::size_t span = std::size_t(hi - lo) + 1;
+      std::vector<T> dense(span, T(0));
+      std::vector<unsigned char> present(span, 0);
+      for (std::size_t t = 0; t != n_terms; ++t)
+        {
+          const index_vector& term_indices = terms[t]->nude_indices();
+          const std::vector<T>& term_data = terms[t]->nude_data();
+          for (std::size_t i = 0; i != term_data.size(); ++i)
+            {
+              const std::size_t offset = std::size_t(term_indices[i] - lo);
+              dense[offset] += term_data[i];
+              present[offset] = 1;
+            }
+        }
+
+      std::size_t n_present = 0;
+      for (std::size_t offset = 0; offset != span; ++offset)
+        n_present += present[offset];
+
+      result.resize(n_present);
+      index_vector& indices = result.nude_indices();
+      std::vector<T>& data = result.nude_data();
+      for (std::size_t offset = 0, k = 0; offset != span; ++offset)
+        if (present[offset])
+          {
+            indices[k] = I(lo + offset);
+            data[k] = dense[offset];
+            ++k;
+          }
+      return;
+    }
+
+  // A heap costs more than it saves on few terms
+  if (n_terms < heap_min_terms)
+    {
+      result = *terms[0];
+      for (std::size_t t = 1; t != n_terms; ++t)
+        result += *terms[t];
+      return;
+    }
+
+  std::vector<HeapEntry> heap;
+  heap.reserve(n_terms);
+  std::vector<std::size_t> position(n_terms, 0);
+  std::size_t max_size = 0;
+  for (std::size_t t = 0; t != n_terms; ++t)
+    {
+      const index_vector& term_indices = terms[t]->nude_indices();
+      if (!term_indices.empty())
+        heap.push_back(HeapEntry(term_indices[0], t));
+      if (term_indices.size() > max_size)
+        max_size = term_indices.size();
+    }
+
+  index_vector indices;
+  std::vector<T> data;
+  indices.reserve(max_size);
+  data.reserve(max_size);
+
+  std::size_t n_heap = heap.size();
+  for (std::size_t i = n_heap / 2; i != 0; --i)
+    sift_down(&heap[0], n_heap, i-1);
+
+  // Ties are broken by term number, so each index sums its terms in
+  // order
+  while (n_heap)
+    {
+      const I index = heap[0].first;
+      const std::size_t t = heap[0].second;
+      const index_vector& term_indices = terms[t]->nude_indices();
+      const T& value = terms[t]->nude_data()[position[t]];
+
+      if (!indices.empty() && indices.back() == index)
+        data.back() += value;
+      else
+        {
+          indices.push_back(index);
+          data.push_back(value);
+        }
+
+      if (++position[t] != term_indices.size())
+        heap[0].first = term_indices[position[t]];
+      else
+        heap[0] = heap[--n_heap];
+      sift_down(&heap[0], n_heap, 0);
+    }
+
+  result.nude_indices().swap(indices);
+  result.nude_data().swap(data);
+}
+
+
+template <typename It>
+inline
+typename std::iterator_traits<It>::value_type
+sparse_sum (It first, It last, bool parallel)
+{
+  typedef typename std::iterator_traits<It>::value_type S;
+
+  std::vector<const S*> terms;
+  for (; first != last; ++first)
+    terms.push_back(&*first);
+  const std::size_t n_terms = terms.size();
+
+  S result;
+
+#ifdef _OPENMP
+  const std::size_t n_chunks =
+    std::min(n_terms / 4, std::size_t(omp_get_max_threads()));
+  if (parallel && n_chunks > 1)
+    {
+      std::vector<S> partial(n_chunks);
+
+#pragma omp parallel for schedule(static)
+      for (long c = 0; c < long(n_chunks); ++c)
+        {
+          const std::size_t begin = c * n_terms / n_chunks,
+                            end = (c+1) * n_terms / n_chunks;
+          SparseSum<S>::apply(&terms[begin], end - begin, partial[c]);
+        }
+
+      for (std::size_t stride = 1; stride < n_chunks; stride *= 2)
+        {
+#pragma omp parallel for schedule(static)
+          for (long c = 0; c < long(n_chunks - stride); c += 2*stride)
+            partial[c] += partial[c + stride];
+        }
+
+      result = partial[0];
+      return result;
+    }
+#else
+  (void)parallel;
+#endif
+
+  SparseSum<S>::apply(n_terms ? &terms[0] : NULL, n_terms, result);
+  return result;
+}
+
+} // namespace MetaPhysicL
+
+#endif // METAPHYSICL_SPARSESUM_H
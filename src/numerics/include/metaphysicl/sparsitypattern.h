@@ -0,0 +1,384 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// MetaPhysicL - A metaprogramming library for physics calculations
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+//
+// $Id$
+//
+//--------------------------------------------------------------------------
+
+#ifndef METAPHYSICL_SPARSITYPATTERN_H
+#define METAPHYSICL_SPARSITYPATTERN_H
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <set>
+#include <vector>
+
+#if __cplusplus >= 201103L
+#include <atomic>
+#include <mutex>
+#endif
+
+namespace MetaPhysicL {
+
+// A sorted index vector whose storage is reference counted and
+// copy-on-write: copies share one immutable pattern, and only a
+// modification makes a private copy.  Non-const accessors count as
+// modifications, so code which only reads a possibly shared pattern
+// should do so through a const reference.  Patterns can additionally
+// be interned, so that independently built copies of the same pattern
+// share storage too.
+//
+// Reference counting and interning are thread safe in C++11; in
+// C++98 patterns must not be shared between threads.
+
+template <typename I>
+class SharedIndexVector
+{
+public:
+  typedef I value_type;
+  typedef I& reference;
+  typedef const I& const_reference;
+  typedef I* iterator;
+  typedef const I* const_iterator;
+  typedef std::reverse_iterator<iterator> reverse_iterator;
+  typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+  typedef std::size_t size_type;
+  typedef std::ptrdiff_t difference_type;
+
+  SharedIndexVector() : _rep(NULL) {}
+
+  SharedIndexVector(const SharedIndexVector<I>& src) : _rep(src._rep)
+    { acquire(_rep); }
+
+#if __cplusplus >= 201103L
+  SharedIndexVector(SharedIndexVector<I>&& src) : _rep(src._rep)
+    { src._rep = NULL; }
+
+  SharedIndexVector<I>& operator= (SharedIndexVector<I>&& src)
+    { std::swap(_rep, src._rep); return *this; }
+#endif
+
+  ~SharedIndexVector() { release(_rep); }
+
+  SharedIndexVector<I>& operator= (const SharedIndexVector<I>& src)
+    {
+      acquire(src._rep);
+      release(_rep);
+      _rep = src._rep;
+      return *this;
+    }
+
+  size_type size() const { return _rep ? _rep->indices.size() : 0; }
+
+  bool empty() const { return !this->size(); }
+
+  const_iterator begin() const { return this->empty() ? NULL : &_rep->indices[0]; }
+
+  const_iterator end() const { return this->begin() + this->size(); }
+
+  iterator begin()
+    {
+      if (this->empty())
+        return NULL;
+      this->detach();
+      return &_rep->indices[0];
+    }
+
+  iterator end() { return this->begin() + this->size(); }
+
+  const_reverse_iterator rbegin() const { return const_reverse_iterator(this->end()); }
+
+  const_reverse_iterator rend() const { return const_reverse_iterator(this->begin()); }
+
+  reverse_iterator rbegin() { return reverse_iterator(this->end()); }
+
+  reverse_iterator rend() { return reverse_iterator(this->begin()); }
+
+  const I& operator[] (size_type i) const { return _rep->indices[i]; }
+
+  I& operator[] (size_type i) { this->detach(); return _rep->indices[i]; }
+
+  const I& back() const { return _rep->indices.back(); }
+
+  I& back() { this->detach(); return _rep->indices.back(); }
+
+  void resize(size_type n, const I& val = I())
+    {
+      if (n == this->size())
+        return;
+      this->detach();
+      _rep->indices.resize(n, val);
+    }
+
+  void reserve(size_type n)
+    {
+      if (n <= this->size())
+        return;
+      this->detach();
+      _rep->indices.reserve(n);
+    }
+
+  void push_back(const I& i) { this->detach(); _rep->indices.push_back(i); }
+
+  void clear() { release(_rep); _rep = NULL; }
+
+  void swap(SharedIndexVector<I>& other) { std::swap(_rep, other._rep); }
+
+  // True if we and other are known to hold the same pattern without
+  // comparing them; always the case for copies of each other and for
+  // interned copies of equal patterns.
+  bool shares_with(const SharedIndexVector<I>& other) const
+    { return _rep == other._rep; }
+
+  // Replace our storage with the interned copy of our pattern,
+  // interning it first if no equal pattern has been.  The intern pool
+  // doesn't keep patterns alive: a pattern leaves it when its last
+  // copy is destroyed or modified.
+  void intern();
+
+  // The number of distinct patterns currently interned
+  static std::size_t n_interned()
+    {
+#if __cplusplus >= 201103L
+      std::lock_guard<std::mutex> lock(pool_mutex());
+#endif
+      return pool().size();
+    }
+
+private:
+  struct Rep
+  {
+    Rep() : refcount(1), interned(false) {}
+    Rep(const std::vector<I>& i) : indices(i), refcount(1), interned(false) {}
+
+    std::vector<I> indices;
+#if __cplusplus >= 201103L
+    std::atomic<std::size_t> refcount;
+#else
+    std::size_t refcount;
+#endif
+    bool interned;
+  };
+
+  struct RepLess
+  {
+    bool operator() (const Rep* a, const Rep* b) const
+      { return a->indices < b->indices; }
+  };
+
+  typedef std::set<Rep*, RepLess> pool_type;
+
+  // Never destroyed, so that patterns outliving static destruction
+  // can still be released
+  static pool_type& pool() { static pool_type* p = new pool_type; return *p; }
+
+#if __cplusplus >= 201103L
+  static std::mutex& pool_mutex()
+    { static std::mutex* m = new std::mutex; return *m; }
+#endif
+
+  static void acquire(Rep* rep) { if (rep) ++rep->refcount; }
+
+  // Take a reference to a pooled pattern unless its last one is
+  // already being released
+  static bool acquire_live(Rep* rep)
+    {
+#if __cplusplus >= 201103L
+      std::size_t count = rep->refcount;
+      while (count)
+        if (rep->refcount.compare_exchange_weak(count, count+1))
+          return true;
+      return false;
+#else
+      acquire(rep);
+      return true;
+#endif
+    }
+
+  static void release(Rep* rep)
+    {
+      if (!rep || --rep->refcount)
+        return;
+
+      if (rep->interned)
+        {
+#if __cplusplus >= 201103L
+          std::lock_guard<std::mutex> lock(pool_mutex());
+#endif
+          // intern() may already have replaced us in the pool
+          typename pool_type::iterator it = pool().find(rep);
+          if (it != pool().end() && *it == rep)
+            pool().erase(it);
+        }
+
+      delete rep;
+    }
+
+  // Make sure we hold the only reference to our storage, and that it
+  // isn't in the intern pool, where other copies could pick it up
+  void detach()
+    {
+      if (!_rep)
+        _rep = new Rep();
+      else if (_rep->refcount > 1 || _rep->interned)
+        {
+          Rep* copy = new Rep(_rep->indices);
+          release(_rep);
+          _rep = copy;
+        }
+    }
+
+  Rep* _rep;
+};
+
+
+template <typename I>
+inline
+void
+SharedIndexVector<I>::intern()
+{
+  if (!_rep)
+    return;
+
+  Rep* old_rep = _rep;
+
+  {
+#if __cplusplus >= 201103L
+    std::lock_guard<std::mutex> lock(pool_mutex());
+#endif
+
+    if (_rep->interned)
+      return;
+
+    std::pair<typename pool_type::iterator, bool> found = pool().insert(_rep);
+
+    if (!found.second && acquire_live(*found.first))
+      _rep = *found.first;
+    else
+      {
+        // An equal pattern in the pool which is being released gets
+        // replaced by ours
+        if (!found.second)
+          {
+            pool().erase(found.first);
+            pool().insert(_rep);
+          }
+        _rep->interned = true;
+        return;
+      }
+  }
+
+  release(old_rep);
+}
+
+
+// The storage type DynamicSparseNumberBase uses for its index
+// vectors.  Copying dynamic sparse numbers copies their index
+// vectors, and thousands of derivative objects can end up with the
+// same one; defining METAPHYSICL_SHARED_SPARSITY makes them share
+// storage instead, and lets operations on operands with a shared
+// pattern skip merging indices.  Specializing SparsityStorage picks
+// the storage for a single index type.
+
+template <typename I>
+struct SparsityStorage
+{
+#ifdef METAPHYSICL_SHARED_SPARSITY
+  typedef SharedIndexVector<I> type;
+#else
+  typedef std::vector<I> type;
+#endif
+};
+
+
+// True if the two index vectors are known to be identical without
+// comparing them, in which case operations can use a dense loop over
+// their data.
+template <typename IndexVector, typename IndexVector2>
+inline
+bool
+same_sparsity(const IndexVector& a, const IndexVector2& b)
+{
+  return static_cast<const void*>(&a) == static_cast<const void*>(&b);
+}
+
+template <typename I>
+inline
+bool
+same_sparsity(const SharedIndexVector<I>& a, const SharedIndexVector<I>& b)
+{
+  return a.shares_with(b);
+}
+
+
+// True if the two index vectors hold the same indices
+template <typename IndexVector, typename IndexVector2>
+inline
+bool
+equal_sparsity(const IndexVector& a, const IndexVector2& b)
+{
+  return same_sparsity(a, b) ||
+    (a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin()));
+}
+
+
+// Copy an index vector; vectors of the same type share storage if
+// they can.
+template <typename IndexVector, typename IndexVector2>
+inline
+void
+copy_sparsity(IndexVector& dest, const IndexVector2& src)
+{
+  dest.resize(src.size());
+  std::copy(src.begin(), src.end(), dest.begin());
+}
+
+template <typename IndexVector>
+inline
+void
+copy_sparsity(IndexVector& dest, const IndexVector& src)
+{
+  dest = src;
+}
+
+
+// Interning is a no-op for unshared index vectors
+template <typename IndexVector>
+inline
+void
+intern_sparsity(IndexVector&)
+{
+}
+
+template <typename I>
+inline
+void
+intern_sparsity(SharedIndexVector<I>& a)
+{
+  a.intern();
+}
+
+} // namespace MetaPhysicL
+
+#endif // METAPHYSICL_SPARSITYPATTERN_H
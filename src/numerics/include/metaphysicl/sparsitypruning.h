@@ -0,0 +1,157 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// MetaPhysicL - A metaprogramming library for physics calculations
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+//
+// $Id$
+//
+//--------------------------------------------------------------------------
+
+#ifndef METAPHYSICL_SPARSITYPRUNING_H
+#define METAPHYSICL_SPARSITYPRUNING_H
+
+#include <cmath>
+#include <complex>
+#include <cstddef>
+
+#include "metaphysicl/compare_types.h"
+
+namespace MetaPhysicL {
+
+// A policy for dropping negligible entries from dynamic sparse
+// numbers.  Cancellation in long chains of operations leaves entries
+// which are zero to within roundoff, and every later merge carries
+// them along; pruning them bounds the growth of sparsity patterns.
+//
+// An entry is negligible if its magnitude is at most the absolute
+// tolerance, or at most the relative tolerance times the largest
+// magnitude in the same number.  With both tolerances zero, only
+// exact zeros are negligible.  Entries which aren't builtin numbers,
+// such as nested dual numbers, are never pruned.
+//
+// Numbers are pruned at checkpoints by calling sparsity_prune(policy)
+// on them.  While a policy is active on a thread, numbers are also
+// pruned after each operation which merges another pattern into
+// theirs: +=, -=, and the fused DualNumber updates.
+//
+//   SparsityPruning pruning(0, 1e-14);
+//   {
+//     SparsityPruning::Scope prune(pruning);
+//     compute_residual(x, r);
+//   }
+//   std::cout << pruning.dropped() << " of " << pruning.examined();
+//
+// In C++11 each thread has its own active policy; in C++98 there is
+// one, and a policy must not be shared between threads.
+
+class SparsityPruning
+{
+public:
+  SparsityPruning(double absolute_tolerance = 0,
+                  double relative_tolerance = 0) :
+    _absolute_tolerance(absolute_tolerance),
+    _relative_tolerance(relative_tolerance),
+    _passes(0), _examined(0), _dropped(0), _peak_size(0) {}
+
+  // Makes a policy active until the Scope is destroyed
+  class Scope
+  {
+  public:
+    Scope(SparsityPruning& policy) : _previous(active_ref())
+      { active_ref() = &policy; }
+
+    ~Scope() { active_ref() = _previous; }
+
+  private:
+    SparsityPruning* _previous;
+  };
+
+  // The policy active on this thread, or NULL
+  static SparsityPruning* active() { return active_ref(); }
+
+  double absolute_tolerance() const { return _absolute_tolerance; }
+  double relative_tolerance() const { return _relative_tolerance; }
+
+  // The magnitude below which entries are dropped from a number
+  // whose largest entry has magnitude max_magnitude
+  double threshold(double max_magnitude) const
+  {
+    const double relative = _relative_tolerance * max_magnitude;
+    return relative > _absolute_tolerance ? relative : _absolute_tolerance;
+  }
+
+  // Statistics: the numbers pruned, the entries they had, the
+  // entries dropped from them, and the most entries any had left
+  std::size_t passes() const { return _passes; }
+  std::size_t examined() const { return _examined; }
+  std::size_t dropped() const { return _dropped; }
+  std::size_t peak_size() const { return _peak_size; }
+
+  void clear_statistics() { _passes = _examined = _dropped = _peak_size = 0; }
+
+  // Record one number pruned from n_examined to n_examined - n_dropped
+  // entries
+  void record (std::size_t n_examined, std::size_t n_dropped)
+  {
+    ++_passes;
+    _examined += n_examined;
+    _dropped += n_dropped;
+    if (n_examined - n_dropped > _peak_size)
+      _peak_size = n_examined - n_dropped;
+  }
+
+private:
+  static SparsityPruning*& active_ref()
+  {
+#if __cplusplus >= 201103L
+    static thread_local SparsityPruning* policy = NULL;
+#else
+    static SparsityPruning* policy = NULL;
+#endif
+    return policy;
+  }
+
+  double _absolute_tolerance, _relative_tolerance;
+  std::size_t _passes, _examined, _dropped, _peak_size;
+};
+
+
+// How pruning measures entries of type T
+template <typename T, bool builtin = BuiltinTraits<T>::value>
+struct PruneMagnitude
+{
+  static double value (const T& v) { return std::abs(v); }
+
+  static bool negligible (const T& v, double threshold)
+    { return !(std::abs(v) > threshold); }
+};
+
+template <typename T>
+struct PruneMagnitude<T, false>
+{
+  static double value (const T&) { return 0; }
+
+  static bool negligible (const T&, double) { return false; }
+};
+
+} // namespace MetaPhysicL
+
+#endif // METAPHYSICL_SPARSITYPRUNING_H
@@ -0,0 +1,536 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// MetaPhysicL - A metaprogramming library for physics calculations
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+//
+// $Id$
+//
+//--------------------------------------------------------------------------
+
+
+#ifndef METAPHYSICL_TAYLORNUMBER_H
+#define METAPHYSICL_TAYLORNUMBER_H
+
+#include <cmath>
+#include <ostream>
+
+#include "metaphysicl/compare_types.h"
+#include "metaphysicl/raw_type.h"
+
+namespace MetaPhysicL {
+
+// A function of one variable t, truncated after its t^order term.
+// coefficient(k) is d^k f/dt^k / k! at t = 0.
+//
+// Products and quotients are convolutions of the coefficients, and
+// the std:: functions use the usual recurrences, so each operation
+// costs O(order^2) and a number holds order+1 values.
+
+template <typename T, unsigned int order>
+class TaylorNumber
+{
+public:
+  typedef T value_type;
+
+  TaylorNumber() {}
+
+  template <typename T2>
+  TaylorNumber(const T2& val)
+    { _coef[0] = val; for (unsigned int k=1; k <= order; ++k) _coef[k] = 0; }
+
+  // Returns x + t v
+  template <typename T2, typename T3>
+  TaylorNumber(const T2& x, const T3& v)
+    {
+      _coef[0] = x;
+      for (unsigned int k=1; k <= order; ++k) _coef[k] = 0;
+      if (order) _coef[1] = v;
+    }
+
+  template <typename T2>
+  TaylorNumber(const TaylorNumber<T2, order>& src)
+    { for (unsigned int k=0; k <= order; ++k) _coef[k] = src.coefficient(k); }
+
+  T& value() { return _coef[0]; }
+
+  const T& value() const { return _coef[0]; }
+
+  T& coefficient(unsigned int k) { return _coef[k]; }
+
+  const T& coefficient(unsigned int k) const { return _coef[k]; }
+
+  // Returns d^k f/dt^k
+  T derivative(unsigned int k) const
+    {
+      T returnval = _coef[k];
+      for (unsigned int j=2; j <= k; ++j)
+        returnval *= j;
+      return returnval;
+    }
+
+  TaylorNumber<T,order> operator- () const
+    {
+      TaylorNumber<T,order> returnval;
+      for (unsigned int k=0; k <= order; ++k)
+        returnval._coef[k] = -_coef[k];
+      return returnval;
+    }
+
+  template <typename T2>
+  TaylorNumber<T,order>& operator+= (const TaylorNumber<T2,order>& a)
+    { for (unsigned int k=0; k <= order; ++k) _coef[k] += a.coefficient(k); return *this; }
+
+  template <typename T2>
+  TaylorNumber<T,order>& operator+= (const T2& a)
+    { _coef[0] += a; return *this; }
+
+  template <typename T2>
+  TaylorNumber<T,order>& operator-= (const TaylorNumber<T2,order>& a)
+    { for (unsigned int k=0; k <= order; ++k) _coef[k] -= a.coefficient(k); return *this; }
+
+  template <typename T2>
+  TaylorNumber<T,order>& operator-= (const T2& a)
+    { _coef[0] -= a; return *this; }
+
+  // Working down from the top coefficient leaves the lower ones, which
+  // are still needed, untouched, even when a is *this
+  template <typename T2>
+  TaylorNumber<T,order>& operator*= (const TaylorNumber<T2,order>& a)
+    {
+      for (unsigned int k=order+1; k-- != 0;)
+        {
+          T product = _coef[k] * a.coefficient(0);
+          for (unsigned int j=1; j <= k; ++j)
+            product += _coef[k-j] * a.coefficient(j);
+          _coef[k] = product;
+        }
+      return *this;
+    }
+
+  template <typename T2>
+  TaylorNumber<T,order>& operator*= (const T2& a)
+    { for (unsigned int k=0; k <= order; ++k) _coef[k] *= a; return *this; }
+
+  // Working up from the value, each quotient coefficient only needs
+  // the ones already found; a is copied in case it is *this
+  template <typename T2>
+  TaylorNumber<T,order>& operator/= (const TaylorNumber<T2,order>& a)
+    {
+      const TaylorNumber<T2,order> b = a;
+      for (unsigned int k=0; k <= order; ++k)
+        {
+          for (unsigned int j=1; j <= k; ++j)
+            _coef[k] -= b.coefficient(j) * _coef[k-j];
+          _coef[k] /= b.coefficient(0);
+        }
+      return *this;
+    }
+
+  template <typename T2>
+  TaylorNumber<T,order>& operator/= (const T2& a)
+    { for (unsigned int k=0; k <= order; ++k) _coef[k] /= a; return *this; }
+
+private:
+  T _coef[order+1];
+};
+
+
+//
+// Non-member functions
+//
+
+#define TaylorNumber_op(opname) \
+template <typename T, typename T2, unsigned int order> \
+inline \
+typename CompareTypes<TaylorNumber<T,order>,TaylorNumber<T2,order> >::supertype \
+operator opname (const TaylorNumber<T,order>& a, const TaylorNumber<T2,order>& b) \
+{ \
+  typedef typename CompareTypes<TaylorNumber<T,order>,TaylorNumber<T2,order> >::supertype TS; \
+  TS returnval(a); \
+  returnval opname##= b; \
+  return returnval; \
+} \
+ \
+template <typename T, typename T2, unsigned int order> \
+inline \
+typename CompareTypes<TaylorNumber<T,order>,T2>::supertype \
+operator opname (const TaylorNumber<T,order>& a, const T2& b) \
+{ \
+  typedef typename CompareTypes<TaylorNumber<T,order>,T2>::supertype TS; \
+  TS returnval(a); \
+  returnval opname##= b; \
+  return returnval; \
+} \
+ \
+template <typename T, typename T2, unsigned int order> \
+inline \
+typename CompareTypes<TaylorNumber<T2,order>,T>::supertype \
+operator opname (const T& a, const TaylorNumber<T2,order>& b) \
+{ \
+  typedef typename CompareTypes<TaylorNumber<T2,order>,T>::supertype TS; \
+  TS returnval(a); \
+  returnval opname##= b; \
+  return returnval; \
+}
+
+TaylorNumber_op(+)
+TaylorNumber_op(-)
+TaylorNumber_op(*)
+TaylorNumber_op(/)
+
+// Comparisons, like those of DualNumbers, only look at values
+#define TaylorNumber_compare(opname) \
+template <typename T, typename T2, unsigned int order> \
+inline \
+bool \
+operator opname (const TaylorNumber<T,order>& a, const TaylorNumber<T2,order>& b) \
+{ \
+  return (a.value() opname b.value()); \
+} \
+ \
+template <typename T, typename T2, unsigned int order> \
+inline \
+typename boostcopy::enable_if_class< \
+  typename CompareTypes<TaylorNumber<T,order>,T2>::supertype, \
+  bool \
+>::type \
+operator opname (const TaylorNumber<T,order>& a, const T2& b) \
+{ \
+  return (a.value() opname b); \
+} \
+ \
+template <typename T, typename T2, unsigned int order> \
+inline \
+typename boostcopy::enable_if_class< \
+  typename CompareTypes<TaylorNumber<T2,order>,T>::supertype, \
+  bool \
+>::type \
+operator opname (const T& a, const TaylorNumber<T2,order>& b) \
+{ \
+  return (a opname b.value()); \
+}
+
+TaylorNumber_compare(>)
+TaylorNumber_compare(>=)
+TaylorNumber_compare(<)
+TaylorNumber_compare(<=)
+TaylorNumber_compare(==)
+TaylorNumber_compare(!=)
+
+template <typename T, unsigned int order>
+inline
+std::ostream&
+operator<< (std::ostream& output, const TaylorNumber<T,order>& a)
+{
+  output << '(' << a.coefficient(0);
+  for (unsigned int k=1; k <= order; ++k)
+    output << ',' << a.coefficient(k);
+  return output << ')';
+}
+
+
+// Returns f with f(0) = f0 and f' = g a', for the functions whose
+// derivatives are easier to expand than they are
+template <typename T, unsigned int order>
+inline
+TaylorNumber<T,order>
+taylor_chain (const T& f0,
+              const TaylorNumber<T,order>& g,
+              const TaylorNumber<T,order>& a)
+{
+  TaylorNumber<T,order> returnval;
+  returnval.value() = f0;
+  for (unsigned int k=1; k <= order; ++k)
+    {
+      returnval.coefficient(k) = 0;
+      for (unsigned int j=1; j <= k; ++j)
+        returnval.coefficient(k) += T(j) * a.coefficient(j) * g.coefficient(k-j);
+      returnval.coefficient(k) /= k;
+    }
+  return returnval;
+}
+
+
+// sin and cos, or sinh and cosh, are each other's derivatives up to
+// sign, so they are expanded together
+template <typename T, unsigned int order>
+inline
+void taylor_sincos (const TaylorNumber<T,order>& a,
+                    TaylorNumber<T,order>& s,
+                    TaylorNumber<T,order>& c,
+                    bool hyperbolic)
+{
+  s.value() = hyperbolic ? std::sinh(a.value()) : std::sin(a.value());
+  c.value() = hyperbolic ? std::cosh(a.value()) : std::cos(a.value());
+  for (unsigned int k=1; k <= order; ++k)
+    {
+      T ds = 0, dc = 0;
+      for (unsigned int j=1; j <= k; ++j)
+        {
+          ds += T(j) * a.coefficient(j) * c.coefficient(k-j);
+          dc += T(j) * a.coefficient(j) * s.coefficient(k-j);
+        }
+      s.coefficient(k) = ds / k;
+      c.coefficient(k) = (hyperbolic ? dc : -dc) / k;
+    }
+}
+
+
+// ScalarTraits, RawType, CompareTypes specializations
+
+template <typename T, unsigned int order>
+struct ScalarTraits<TaylorNumber<T,order> >
+{
+  static const bool value = ScalarTraits<T>::value;
+};
+
+#define TaylorNumber_comparisons(templatename) \
+template<typename T, unsigned int order, bool reverseorder> \
+struct templatename<TaylorNumber<T,order>, TaylorNumber<T,order>, reverseorder> { \
+  typedef TaylorNumber<T,order> supertype; \
+}; \
+ \
+template<typename T, typename T2, unsigned int order, bool reverseorder> \
+struct templatename<TaylorNumber<T,order>, TaylorNumber<T2,order>, reverseorder> { \
+  typedef TaylorNumber<typename Symmetric##templatename<T, T2, reverseorder>::supertype, \
+                       order> supertype; \
+}; \
+ \
+template<typename T, typename T2, unsigned int order, bool reverseorder> \
+struct templatename<TaylorNumber<T,order>, T2, reverseorder, \
+                    typename boostcopy::enable_if<BuiltinTraits<T2> >::type> { \
+  typedef TaylorNumber<typename Symmetric##templatename<T, T2, reverseorder>::supertype, \
+                       order> supertype; \
+}
+
+TaylorNumber_comparisons(CompareTypes);
+TaylorNumber_comparisons(PlusType);
+TaylorNumber_comparisons(MinusType);
+TaylorNumber_comparisons(MultipliesType);
+TaylorNumber_comparisons(DividesType);
+
+template <typename T, unsigned int order>
+struct RawType<TaylorNumber<T,order> >
+{
+  typedef typename RawType<T>::value_type value_type;
+
+  static value_type value(const TaylorNumber<T,order>& a) { return raw_value(a.value()); }
+};
+
+} // namespace MetaPhysicL
+
+
+namespace std {
+
+using MetaPhysicL::TaylorNumber;
+using MetaPhysicL::taylor_chain;
+using MetaPhysicL::taylor_sincos;
+
+template <typename T, unsigned int order>
+inline
+TaylorNumber<T,order> exp (const TaylorNumber<T,order>& a)
+{
+  TaylorNumber<T,order> returnval;
+  returnval.value() = std::exp(a.value());
+  for (unsigned int k=1; k <= order; ++k)
+    {
+      returnval.coefficient(k) = 0;
+      for (unsigned int j=1; j <= k; ++j)
+        returnval.coefficient(k) += T(j) * a.coefficient(j) * returnval.coefficient(k-j);
+      returnval.coefficient(k) /= k;
+    }
+  return returnval;
+}
+
+template <typename T, unsigned int order>
+inline
+TaylorNumber<T,order> log (const TaylorNumber<T,order>& a)
+{
+  TaylorNumber<T,order> returnval;
+  returnval.value() = std::log(a.value());
+  for (unsigned int k=1; k <= order; ++k)
+    {
+      T sum = 0;
+      for (unsigned int j=1; j < k; ++j)
+        sum += T(j) * returnval.coefficient(j) * a.coefficient(k-j);
+      returnval.coefficient(k) = (a.coefficient(k) - sum / k) / a.value();
+    }
+  return returnval;
+}
+
+template <typename T, unsigned int order>
+inline
+TaylorNumber<T,order> log10 (const TaylorNumber<T,order>& a)
+{
+  return std::log(a) / std::log(T(10));
+}
+
+template <typename T, unsigned int order>
+inline
+TaylorNumber<T,order> sqrt (const TaylorNumber<T,order>& a)
+{
+  TaylorNumber<T,order> returnval;
+  returnval.value() = std::sqrt(a.value());
+  for (unsigned int k=1; k <= order; ++k)
+    {
+      T sum = 0;
+      for (unsigned int j=1; j < k; ++j)
+        sum += returnval.coefficient(j) * returnval.coefficient(k-j);
+      returnval.coefficient(k) = (a.coefficient(k) - sum) / (2 * returnval.value());
+    }
+  return returnval;
+}
+
+// a^b for constant b, from a f' = b a' f
+template <typename T, typename T2, unsigned int order>
+inline
+typename MetaPhysicL::boostcopy::enable_if_class<
+  typename MetaPhysicL::CompareTypes<TaylorNumber<T,order>,T2>::supertype,
+  TaylorNumber<T,order>
+>::type
+pow (const TaylorNumber<T,order>& a, const T2& b)
+{
+  TaylorNumber<T,order> returnval;
+  returnval.value() = std::pow(a.value(), b);
+  for (unsigned int k=1; k <= order; ++k)
+    {
+      returnval.coefficient(k) = 0;
+      for (unsigned int j=1; j <= k; ++j)
+        returnval.coefficient(k) +=
+          (T(b) * j - T(k - j)) * a.coefficient(j) * returnval.coefficient(k-j);
+      returnval.coefficient(k) /= k * a.value();
+    }
+  return returnval;
+}
+
+template <typename T, typename T2, unsigned int order>
+inline
+typename MetaPhysicL::CompareTypes<TaylorNumber<T,order>,TaylorNumber<T2,order> >::supertype
+pow (const TaylorNumber<T,order>& a, const TaylorNumber<T2,order>& b)
+{
+  return std::exp(b * std::log(a));
+}
+
+template <typename T, typename T2, unsigned int order>
+inline
+typename MetaPhysicL::boostcopy::enable_if_class<
+  typename MetaPhysicL::CompareTypes<TaylorNumber<T2,order>,T>::supertype,
+  TaylorNumber<T2,order>
+>::type
+pow (const T& a, const TaylorNumber<T2,order>& b)
+{
+  return std::exp(b * std::log(T2(a)));
+}
+
+#define TaylorNumber_sincos(funcname, hyperbolic, result) \
+template <typename T, unsigned int order> \
+inline \
+TaylorNumber<T,order> funcname (const TaylorNumber<T,order>& a) \
+{ \
+  TaylorNumber<T,order> s, c; \
+  taylor_sincos(a, s, c, hyperbolic); \
+  return result; \
+}
+
+TaylorNumber_sincos(sin, false, s)
+TaylorNumber_sincos(cos, false, c)
+TaylorNumber_sincos(tan, false, s / c)
+TaylorNumber_sincos(sinh, true, s)
+TaylorNumber_sincos(cosh, true, c)
+TaylorNumber_sincos(tanh, true, s / c)
+
+template <typename T, unsigned int order>
+inline
+TaylorNumber<T,order> asin (const TaylorNumber<T,order>& a)
+{
+  return taylor_chain(std::asin(a.value()), 1 / std::sqrt(1 - a * a), a);
+}
+
+template <typename T, unsigned int order>
+inline
+TaylorNumber<T,order> acos (const TaylorNumber<T,order>& a)
+{
+  return taylor_chain(std::acos(a.value()), -1 / std::sqrt(1 - a * a), a);
+}
+
+template <typename T, unsigned int order>
+inline
+TaylorNumber<T,order> atan (const TaylorNumber<T,order>& a)
+{
+  return taylor_chain(std::atan(a.value()), 1 / (1 + a * a), a);
+}
+
+template <typename T, unsigned int order>
+inline
+TaylorNumber<T,order> abs (const TaylorNumber<T,order>& a)
+{
+  return a.value() < 0 ? -a : a;
+}
+
+template <typename T, unsigned int order>
+inline
+TaylorNumber<T,order> fabs (const TaylorNumber<T,order>& a)
+{
+  return std::abs(a);
+}
+
+#define TaylorNumber_std_select(funcname, choose_a) \
+template <typename T, typename T2, unsigned int order> \
+inline \
+typename MetaPhysicL::CompareTypes<TaylorNumber<T,order>,TaylorNumber<T2,order> >::supertype \
+funcname (const TaylorNumber<T,order>& a, const TaylorNumber<T2,order>& b) \
+{ \
+  typedef typename MetaPhysicL::CompareTypes<TaylorNumber<T,order>,TaylorNumber<T2,order> >::supertype TS; \
+  return (choose_a) ? TS(a) : TS(b); \
+} \
+ \
+template <typename T, unsigned int order> \
+inline \
+TaylorNumber<T,order> \
+funcname (const TaylorNumber<T,order>& a, const TaylorNumber<T,order>& b) \
+{ \
+  return (choose_a) ? a : b; \
+} \
+ \
+template <typename T, typename T2, unsigned int order> \
+inline \
+typename MetaPhysicL::CompareTypes<TaylorNumber<T,order>,T2>::supertype \
+funcname (const TaylorNumber<T,order>& a, const T2& b) \
+{ \
+  typedef typename MetaPhysicL::CompareTypes<TaylorNumber<T,order>,T2>::supertype TS; \
+  return (choose_a) ? TS(a) : TS(b); \
+} \
+ \
+template <typename T, typename T2, unsigned int order> \
+inline \
+typename MetaPhysicL::CompareTypes<TaylorNumber<T2,order>,T>::supertype \
+funcname (const T& a, const TaylorNumber<T2,order>& b) \
+{ \
+  typedef typename MetaPhysicL::CompareTypes<TaylorNumber<T2,order>,T>::supertype TS; \
+  return (choose_a) ? TS(a) : TS(b); \
+}
+
+TaylorNumber_std_select(max, a > b)
+TaylorNumber_std_select(min, !(a > b))
+
+} // namespace std
+
+#endif // METAPHYSICL_TAYLORNUMBER_H
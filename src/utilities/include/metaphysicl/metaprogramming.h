@@ -31,6 +31,20 @@
 
 #include "metaphysicl/compare_types.h" // for BuiltinTraits
 
+#include <cstddef>
+
+// Small fixed-size kernels are expanded at compile time up to this
+// length; longer ones are left as loops.
+#ifndef METAPHYSICL_UNROLL_LIMIT
+#define METAPHYSICL_UNROLL_LIMIT 16
+#endif
+
+#if defined(__GNUC__)
+#define METAPHYSICL_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define METAPHYSICL_ALWAYS_INLINE inline
+#endif
+
 namespace MetaPhysicL
 {
   // Helper metafunctions
@@ -82,6 +96,30 @@ namespace MetaPhysicL
   };
 
 
+  // Unroll<N>::apply(f) calls f(0), f(1), ... f(N-1).  Up to
+  // METAPHYSICL_UNROLL_LIMIT the calls are written out by recursion,
+  // so kernels on short NumberVector and NumberArray types don't
+  // depend on the optimizer choosing to peel their loops.
+  template <std::size_t N, bool unrolled = (N <= METAPHYSICL_UNROLL_LIMIT)>
+  struct Unroll {
+    template <typename F>
+    static METAPHYSICL_ALWAYS_INLINE void apply(const F & f)
+      { for (std::size_t i=0; i != N; ++i) f(i); }
+  };
+
+  template <std::size_t N>
+  struct Unroll<N, true> {
+    template <typename F>
+    static METAPHYSICL_ALWAYS_INLINE void apply(const F & f)
+      { Unroll<N-1>::apply(f); f(N-1); }
+  };
+
+  template <>
+  struct Unroll<0, true> {
+    template <typename F>
+    static METAPHYSICL_ALWAYS_INLINE void apply(const F &) {}
+  };
+
 } // end namespace MetaPhysicL
 
 #endif // METAPHYSICL_METAPROGRAMMING_H
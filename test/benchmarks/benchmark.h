@@ -0,0 +1,31 @@
+#ifndef __benchmark_h__
+#define __benchmark_h__
+
+#include <ctime>
+
+// Each benchmark times n_reps repetitions of alternative ways to do
+// the same work, and prints a line of times for each case it tries,
+// ending with a checksum of the results so the work isn't optimized
+// away.  The unit tests check that the alternatives agree.
+
+int ensemble_pde_benchmark (unsigned int n_reps);
+int hashed_sparse_benchmark (unsigned int n_reps);
+int hybrid_sparse_benchmark (unsigned int n_reps);
+int integer_pow_benchmark (unsigned int n_reps);
+int mixed_precision_benchmark (unsigned int n_reps);
+int semidynamic_number_array_benchmark (unsigned int n_reps);
+int small_matrix_benchmark (unsigned int n_reps);
+int sorted_set_benchmark (unsigned int n_reps);
+int sparse_math_benchmark (unsigned int n_reps);
+int sparse_sum_benchmark (unsigned int n_reps);
+int unrolled_kernels_benchmark (unsigned int n_reps);
+int values_only_benchmark (unsigned int n_reps);
+int zero_derivatives_benchmark (unsigned int n_reps);
+
+// Processor time since start, in seconds
+inline double seconds_since (std::clock_t start)
+{
+  return double(std::clock() - start) / CLOCKS_PER_SEC;
+}
+
+#endif // __benchmark_h__
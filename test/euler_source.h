@@ -0,0 +1,132 @@
+#ifndef __euler_source_h__
+#define __euler_source_h__
+
+#include <algorithm>
+#include <cmath>
+
+#include "metaphysicl/dualnumberensemble.h"
+
+// Source terms over a grid of points, evaluated one point at a time
+// or an ensemble of points at a time, for ensemble_pde_unit and the
+// ensemble_pde benchmark
+
+static const std::size_t N_grid = 40; // grid intervals in x and y
+static const std::size_t N_points = (N_grid+1) * (N_grid+1);
+
+// The Euler source terms of pde_unit.h, with the gradients its
+// NumberVector of DualNumbers carried written out as a DualNumber with
+// two derivatives, evaluated at one point for Scalar = double or at
+// an ensemble of points.  q holds the rho, rho u, rho v and rho e
+// equation residuals.
+template <typename Scalar>
+void evaluate_q (const Scalar & x_in, const Scalar & y_in, Scalar (&q)[4])
+{
+  typedef MetaPhysicL::DualNumber<Scalar, MetaPhysicL::NumberArray<2, Scalar> > ADScalar;
+
+  const double PI = std::acos(-1.);
+
+  const double u_0 = 200.23;
+  const double u_x = 1.1;
+  const double u_y = 1.08;
+  const double v_0 = 1.2;
+  const double v_x = 1.6;
+  const double v_y = .47;
+  const double rho_0 = 100.02;
+  const double rho_x = 2.22;
+  const double rho_y = 0.8;
+  const double p_0 = 150.2;
+  const double p_x = .91;
+  const double p_y = .623;
+  const double a_px = .165;
+  const double a_py = .612;
+  const double a_rhox = 1.0;
+  const double a_rhoy = 1.0;
+  const double a_ux = .1987;
+  const double a_uy = 1.189;
+  const double a_vx = 1.91;
+  const double a_vy = 1.0;
+  const double Gamma = 1.01;
+  const double L = 3.02;
+
+  ADScalar x = x_in, y = y_in;
+  x.derivatives()[0] = 1;
+  y.derivatives()[1] = 1;
+
+  // Treat velocity as a vector
+  MetaPhysicL::NumberArray<2, ADScalar> U;
+
+  // Arbitrary manufactured solution
+  U[0] = u_0 + u_x * std::sin(a_ux * PI * x / L) + u_y * std::cos(a_uy * PI * y / L);
+  U[1] = v_0 + v_x * std::cos(a_vx * PI * x / L) + v_y * std::sin(a_vy * PI * y / L);
+  ADScalar RHO = rho_0 + rho_x * std::sin(a_rhox * PI * x / L) + rho_y * std::cos(a_rhoy * PI * y / L);
+  ADScalar P = p_0 + p_x * std::cos(a_px * PI * x / L) + p_y * std::sin(a_py * PI * y / L);
+
+  // Perfect gas energies
+  ADScalar E = 1./(Gamma-1.)*P/RHO;
+  ADScalar ET = E + .5 * (U[0]*U[0] + U[1]*U[1]);
+
+  // Euler equation residuals, as divergences of fluxes
+  const ADScalar RHOU0 = RHO * U[0], RHOU1 = RHO * U[1], RHOH = RHO * ET + P;
+  q[0] = RHOU0.derivatives()[0] + RHOU1.derivatives()[1];
+  q[1] = (RHOU0 * U[0]).derivatives()[0] + (RHOU0 * U[1]).derivatives()[1] +
+         P.derivatives()[0];
+  q[2] = (RHOU1 * U[0]).derivatives()[0] + (RHOU1 * U[1]).derivatives()[1] +
+         P.derivatives()[1];
+  q[3] = (RHOH * U[0]).derivatives()[0] + (RHOH * U[1]).derivatives()[1];
+}
+
+inline void grid (double * x, double * y)
+{
+  const double h = 1.0/N_grid;
+  for (std::size_t p = 0; p != N_points; ++p)
+    {
+      x[p] = (p / (N_grid+1)) * h;
+      y[p] = (p % (N_grid+1)) * h;
+    }
+}
+
+// Source terms at every grid point, one point at a time
+inline void sweep (const double * x, const double * y, double (*q)[N_points])
+{
+  for (std::size_t p = 0; p != N_points; ++p)
+    {
+      double qp[4];
+      evaluate_q(x[p], y[p], qp);
+      for (unsigned int i = 0; i != 4; ++i)
+        q[i][p] = qp[i];
+    }
+}
+
+// Then W points at a time, repeating the last point to fill out the
+// final ensemble
+template <std::size_t W>
+void ensemble_sweep (const double * x, const double * y, double (*q)[N_points])
+{
+  typedef typename MetaPhysicL::EnsembleType<W, double>::type Scalar;
+
+  for (std::size_t p0 = 0; p0 < N_points; p0 += W)
+    {
+      Scalar xe, ye, qe[4];
+      if (p0 + W <= N_points)
+        {
+          MetaPhysicL::ensemble_gather(x + p0, xe);
+          MetaPhysicL::ensemble_gather(y + p0, ye);
+          evaluate_q(xe, ye, qe);
+          for (unsigned int i = 0; i != 4; ++i)
+            MetaPhysicL::ensemble_scatter(qe[i], q[i] + p0);
+        }
+      else
+        {
+          std::size_t indices[W];
+          for (std::size_t l = 0; l != W; ++l)
+            indices[l] = std::min(p0 + l, N_points - 1);
+          MetaPhysicL::ensemble_gather(x, indices, xe);
+          MetaPhysicL::ensemble_gather(y, indices, ye);
+          evaluate_q(xe, ye, qe);
+          for (unsigned int i = 0; i != 4; ++i)
+            MetaPhysicL::ensemble_scatter(qe[i], q[i], indices);
+        }
+    }
+}
+
+#endif // __euler_source_h__